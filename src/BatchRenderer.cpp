@@ -0,0 +1,59 @@
+#include "BatchRenderer.hpp"
+
+#include <algorithm>
+
+BatchRenderer::BatchRenderer(int views, int width, int height)
+	: m_Renderers(views, Renderer(width, height)), m_Sprites(views), m_ThreadPool(nullptr), m_LastCount(0), m_BatchMs(0.f)
+{
+
+}
+
+void BatchRenderer::SetThreadPool(ThreadPool *pool) {
+	m_ThreadPool = pool;
+}
+
+int BatchRenderer::GetViewCount() const {
+	return (int)m_Renderers.size();
+}
+
+Renderer &BatchRenderer::GetRenderer(int view) {
+	return m_Renderers[view];
+}
+
+const FrameBuffer &BatchRenderer::GetFrameBuffer(int view) const {
+	return m_Renderers[view].GetFrameBuffer();
+}
+
+void BatchRenderer::Render(const Map &map, const std::vector<Camera> &cams) {
+	int count = std::min((int)cams.size(), GetViewCount());
+
+	sf::Clock clock;
+
+	// one view per band, every renderer draws its view on the thread that picked it up
+	auto job = [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			std::vector<Sprite *> &sprites = m_Sprites[i];
+			sprites = map.GetSprites();
+			Map::SortSprites(sprites, cams[i].position);
+
+			m_Renderers[i].Render(map, cams[i]);
+			m_Renderers[i].DrawSprites(sprites, cams[i]);
+		}
+	};
+
+	if (m_ThreadPool)
+		m_ThreadPool->ParallelFor(count, count, job);
+	else
+		job(0, count);
+
+	m_LastCount = count;
+	m_BatchMs = clock.getElapsedTime().asMicroseconds()/1000.f;
+}
+
+float BatchRenderer::GetFramesPerSecond() const {
+	return m_BatchMs > 0.f ? m_LastCount*1000.f/m_BatchMs : 0.f;
+}
+
+float BatchRenderer::GetBatchMs() const {
+	return m_BatchMs;
+}
\ No newline at end of file
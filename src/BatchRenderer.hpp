@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include "Renderer.hpp"
+#include "ThreadPool.hpp"
+
+// many small views of one map rendered in one call, for agents that each need their own first
+// person view every step. the map, wall atlas and sprite sheets are shared, each view keeps its own
+// renderer and frame, and the views are handed out to the pool's threads whole
+class BatchRenderer {
+public:
+	BatchRenderer(int views, int width, int height);
+
+	void SetThreadPool(ThreadPool *pool);
+
+	int GetViewCount() const;
+
+	// to set one view's modes or read its hit records. each view is drawn on a single thread,
+	// so leave the views' own thread pool unset
+	Renderer &GetRenderer(int view);
+	const FrameBuffer &GetFrameBuffer(int view) const;
+
+	// render view i from cams[i], for as many cameras as there are views, each with the map's
+	// sprites drawn back to front from its own camera
+	void Render(const Map &map, const std::vector<Camera> &cams);
+
+	// frames rendered per second across the whole of the last batch, and its wall clock time
+	float GetFramesPerSecond() const;
+	float GetBatchMs() const;
+
+private:
+	std::vector<Renderer>					m_Renderers;
+	std::vector<std::vector<Sprite *> >		m_Sprites;
+	ThreadPool								*m_ThreadPool;
+
+	int										m_LastCount;
+	float									m_BatchMs;
+};
\ No newline at end of file
@@ -0,0 +1,13 @@
+#include "Camera.hpp"
+#include <cmath>
+
+Camera::Camera(const sf::Vector2f &pos, const sf::Vector2f &look, float fov, float height)
+	: position(pos), fov(fov), height(height)
+{
+	float mag = std::sqrt(std::pow(look.x, 2.f) + std::pow(look.y, 2.f));
+	forward = look/mag;
+
+	right = sf::Vector2f(-forward.y, forward.x);
+	mag = std::sqrt(std::pow(right.x, 2.f) + std::pow(right.y, 2.f));
+	right *= (std::tan(fov/2.f)/mag);
+}
\ No newline at end of file
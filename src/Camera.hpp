@@ -0,0 +1,16 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+
+// a view into the map, everything the renderer needs to know about the viewer
+struct Camera {
+	sf::Vector2f	position;
+	sf::Vector2f	forward;
+	sf::Vector2f	right;		// scaled by tan(fov/2)
+
+	float			fov;		// radians
+	float			height;		// eye height, 0 is the floor and 1 the ceiling
+
+	Camera() : fov(0.f), height(0.5f) {};
+	Camera(const sf::Vector2f &pos, const sf::Vector2f &look, float fov, float height=0.5f);
+};
\ No newline at end of file
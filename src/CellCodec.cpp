@@ -0,0 +1,94 @@
+#include "CellCodec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static void PutVarint(std::vector<char> &out, sf::Uint32 value) {
+	while (value >= 0x80) {
+		out.push_back((char)(value | 0x80));
+		value >>= 7;
+	}
+
+	out.push_back((char)value);
+}
+
+static void PutCells(std::vector<char> &out, const sf::Uint32 *cells, int count) {
+	size_t at = out.size();
+	out.resize(at + count*4);
+	std::memcpy(&out[at], cells, count*4);
+}
+
+static bool GetVarint(const char *&data, const char *end, sf::Uint32 &value) {
+	value = 0;
+
+	for (int shift = 0; shift < 35 && data < end; shift += 7) {
+		sf::Uint8 byte = (sf::Uint8)*data++;
+		value |= (sf::Uint32)(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+void CellCodec::Encode(const sf::Uint32 *cells, int count, std::vector<char> &out) {
+	int i = 0;
+
+	while (i < count) {
+		int run = 1;
+		while (i + run < count && cells[i + run] == cells[i])
+			run++;
+
+		if (run > 1) {
+			PutVarint(out, (sf::Uint32)(run - 1) << 1 | 1);
+			PutCells(out, cells + i, 1);
+			i += run;
+			continue;
+		}
+
+		// cells as they are, up to where the next run starts
+		int end = i + 1;
+		while (end < count && !(end + 1 < count && cells[end + 1] == cells[end]))
+			end++;
+
+		PutVarint(out, (sf::Uint32)(end - i - 1) << 1);
+		PutCells(out, cells + i, end - i);
+		i = end;
+	}
+}
+
+bool CellCodec::Decode(const char *data, size_t size, sf::Uint32 *cells, int count) {
+	const char *end = data + size;
+	int i = 0;
+
+	while (i < count) {
+		sf::Uint32 token;
+		if (!GetVarint(data, end, token))
+			return false;
+
+		sf::Uint32 n = (token >> 1) + 1;
+		if (n > (sf::Uint32)(count - i))
+			return false;
+
+		if (token & 1) {
+			if (end - data < 4)
+				return false;
+
+			sf::Uint32 cell;
+			std::memcpy(&cell, data, 4);
+			std::fill(cells + i, cells + i + n, cell);
+			data += 4;
+		} else {
+			if ((size_t)(end - data) < (size_t)n*4)
+				return false;
+
+			std::memcpy(cells + i, data, (size_t)n*4);
+			data += (size_t)n*4;
+		}
+
+		i += n;
+	}
+
+	return data == end;
+}
\ No newline at end of file
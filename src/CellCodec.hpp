@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+// run-length coding of map cells a whole cell at a time, for the chunks of a map file. each token
+// is a varint, the count less one shifted up with the low bit set for a run: a run is followed by
+// the one cell it repeats, anything else by that many cells as they are
+class CellCodec {
+public:
+	// append the coded cells to out
+	static void Encode(const sf::Uint32 *cells, int count, std::vector<char> &out);
+
+	// false unless the data codes exactly `count` cells
+	static bool Decode(const char *data, size_t size, sf::Uint32 *cells, int count);
+};
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "DepthHierarchy.hpp"
+
+#include <algorithm>
+#include <limits>
+
+DepthHierarchy::DepthHierarchy()
+	: m_Size(0)
+{
+
+}
+
+void DepthHierarchy::Build(const float *depth, int width) {
+	int size = 1;
+	while (size < width)
+		size *= 2;
+
+	if (size != m_Size) {
+		m_Size = size;
+		m_Min.assign(2*size, std::numeric_limits<float>::max());
+		m_Max.assign(2*size, std::numeric_limits<float>::max());
+	}
+
+	std::copy(depth, depth + width, m_Min.begin() + size);
+	std::copy(depth, depth + width, m_Max.begin() + size);
+
+	for (int i = size - 1; i > 0; i--) {
+		m_Min[i] = std::min(m_Min[2*i], m_Min[2*i + 1]);
+		m_Max[i] = std::max(m_Max[2*i], m_Max[2*i + 1]);
+	}
+}
+
+float DepthHierarchy::GetMin(int begin, int end) const {
+	float result = std::numeric_limits<float>::max();
+
+	// climb from both ends, taking whole nodes that sit inside the span
+	for (begin += m_Size, end += m_Size; begin < end; begin /= 2, end /= 2) {
+		if (begin & 1)
+			result = std::min(result, m_Min[begin++]);
+		if (end & 1)
+			result = std::min(result, m_Min[--end]);
+	}
+
+	return result;
+}
+
+float DepthHierarchy::GetMax(int begin, int end) const {
+	float result = -std::numeric_limits<float>::max();
+
+	for (begin += m_Size, end += m_Size; begin < end; begin /= 2, end /= 2) {
+		if (begin & 1)
+			result = std::max(result, m_Max[begin++]);
+		if (end & 1)
+			result = std::max(result, m_Max[--end]);
+	}
+
+	return result;
+}
\ No newline at end of file
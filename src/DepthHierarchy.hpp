@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+// min/max tree over a row of depth values, answers span queries in O(log width)
+class DepthHierarchy {
+public:
+	DepthHierarchy();
+
+	void Build(const float *depth, int width);
+
+	// nearest and farthest depth over the columns [begin, end)
+	float GetMin(int begin, int end) const;
+	float GetMax(int begin, int end) const;
+
+private:
+	// leaves start at m_Size, node i covers nodes 2i and 2i+1
+	int					m_Size;
+	std::vector<float>	m_Min;
+	std::vector<float>	m_Max;
+};
\ No newline at end of file
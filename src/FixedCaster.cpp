@@ -0,0 +1,498 @@
+#include "FixedCaster.hpp"
+#include "RayCaster.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FIXEDCASTER_SIMD
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// perpendicular distance across a whole cell for a ray with this direction component
+static Fixed GetDeltaDist(Fixed rayDir) {
+	sf::Int64 d = std::abs((sf::Int64)rayDir);
+	if (d == 0)
+		return FIXED_MAX_DELTA;
+
+	return (Fixed)std::min(((sf::Int64)1 << (2*FIXED_SHIFT))/d, (sf::Int64)FIXED_MAX_DELTA);
+}
+
+FixedRayTable::FixedRayTable()
+	: m_Width(0), m_MaxDist(0)
+{
+	m_Forward[0] = m_Forward[1] = 0;
+	m_Right[0] = m_Right[1] = 0;
+}
+
+void FixedRayTable::Update(const Camera &cam, int screenWidth, float fogDistance) {
+	// side distances are along the view direction, so the fog is the same for every ray
+	m_MaxDist = ToFixed(fogDistance);
+
+	Fixed forward[2] = { ToFixed(cam.forward.x), ToFixed(cam.forward.y) };
+	Fixed right[2] = { ToFixed(cam.right.x), ToFixed(cam.right.y) };
+
+	if (screenWidth == m_Width && std::equal(forward, forward + 2, m_Forward) && std::equal(right, right + 2, m_Right))
+		return;
+
+	m_Width = screenWidth;
+	std::copy(forward, forward + 2, m_Forward);
+	std::copy(right, right + 2, m_Right);
+
+	m_RayDirX.resize(screenWidth);
+	m_RayDirY.resize(screenWidth);
+	m_DeltaDistX.resize(screenWidth);
+	m_DeltaDistY.resize(screenWidth);
+	m_Length.resize(screenWidth);
+
+	for (int x=0; x<screenWidth; ++x) {
+		// x-coordinate in camera space, -1 to 1 as in RayTable
+		Fixed cameraX = (Fixed)(((sf::Int64)(2*x - screenWidth) << FIXED_SHIFT)/screenWidth);
+
+		Fixed rayDirX = forward[0] + (Fixed)(((sf::Int64)right[0]*cameraX) >> FIXED_SHIFT);
+		Fixed rayDirY = forward[1] + (Fixed)(((sf::Int64)right[1]*cameraX) >> FIXED_SHIFT);
+
+		m_RayDirX[x] = rayDirX;
+		m_RayDirY[x] = rayDirY;
+		m_DeltaDistX[x] = GetDeltaDist(rayDirX);
+		m_DeltaDistY[x] = GetDeltaDist(rayDirY);
+		m_Length[x] = FixedCaster::Sqrt((sf::Uint64)((sf::Int64)rayDirX*rayDirX + (sf::Int64)rayDirY*rayDirY));
+	}
+}
+
+int FixedRayTable::GetWidth() const {
+	return m_Width;
+}
+
+const Fixed *FixedRayTable::GetRayDirX() const {
+	return m_RayDirX.data();
+}
+
+const Fixed *FixedRayTable::GetRayDirY() const {
+	return m_RayDirY.data();
+}
+
+const Fixed *FixedRayTable::GetDeltaDistX() const {
+	return m_DeltaDistX.data();
+}
+
+const Fixed *FixedRayTable::GetDeltaDistY() const {
+	return m_DeltaDistY.data();
+}
+
+const Fixed *FixedRayTable::GetLength() const {
+	return m_Length.data();
+}
+
+Fixed FixedRayTable::GetMaxDist() const {
+	return m_MaxDist;
+}
+
+void FixedCaster::Setup(const FixedRayTable &table, const Camera &cam, int x, FixedRay &ray) {
+	Fixed posX = ToFixed(cam.position.x);
+	Fixed posY = ToFixed(cam.position.y);
+
+	ray.rayDirX = table.GetRayDirX()[x];
+	ray.rayDirY = table.GetRayDirY()[x];
+	ray.deltaDistX = table.GetDeltaDistX()[x];
+	ray.deltaDistY = table.GetDeltaDistY()[x];
+	ray.maxDist = table.GetMaxDist();
+
+	ray.mapX = posX >> FIXED_SHIFT;
+	ray.mapY = posY >> FIXED_SHIFT;
+
+	// the part of a cell to the first side either way
+	sf::Int64 fracX = posX & (FIXED_ONE - 1);
+	sf::Int64 fracY = posY & (FIXED_ONE - 1);
+
+	if (ray.rayDirX < 0) {
+		ray.stepX = -1;
+		ray.sideDistX = (Fixed)((fracX*ray.deltaDistX) >> FIXED_SHIFT);
+	} else {
+		ray.stepX = 1;
+		ray.sideDistX = (Fixed)(((FIXED_ONE - fracX)*ray.deltaDistX) >> FIXED_SHIFT);
+	}
+
+	if (ray.rayDirY < 0) {
+		ray.stepY = -1;
+		ray.sideDistY = (Fixed)((fracY*ray.deltaDistY) >> FIXED_SHIFT);
+	} else {
+		ray.stepY = 1;
+		ray.sideDistY = (Fixed)(((FIXED_ONE - fracY)*ray.deltaDistY) >> FIXED_SHIFT);
+	}
+
+	ray.side = false;
+	ray.hit = false;
+}
+
+void FixedCaster::Leap(FixedRay &ray, int r) {
+	// the crossings that would leave the square either way
+	sf::Int64 exitX = ray.sideDistX + (sf::Int64)r*ray.deltaDistX;
+	sf::Int64 exitY = ray.sideDistY + (sf::Int64)r*ray.deltaDistY;
+
+	// far past any fog (FOG_MAX_DISTANCE is 2^30), the side distances would not fit
+	if (std::min(exitX, exitY) >= ((sf::Int64)1 << 30))
+		return;
+
+	// y-sides win ties as in Trace, the other axis' crossings before the exit come from a divide
+	sf::Int64 stepsX, stepsY;
+	if (exitX < exitY) {
+		stepsX = r;
+		stepsY = exitX < ray.sideDistY ? 0 : std::min((sf::Int64)r, (exitX - ray.sideDistY)/ray.deltaDistY + 1);
+	} else {
+		stepsY = r;
+		stepsX = exitY <= ray.sideDistX ? 0 : std::min((sf::Int64)r, (exitY - ray.sideDistX - 1)/ray.deltaDistX + 1);
+	}
+
+	ray.mapX += (int)stepsX*ray.stepX;
+	ray.mapY += (int)stepsY*ray.stepY;
+	ray.sideDistX += (Fixed)(stepsX*ray.deltaDistX);
+	ray.sideDistY += (Fixed)(stepsY*ray.deltaDistY);
+}
+
+bool FixedCaster::Trace(const Map &map, FixedRay &ray) {
+	const sf::Uint8 *field = map.GetDistanceField();
+	int stride = map.GetFieldStride();
+
+	if (!map.IsInside(ray.mapX, ray.mapY)) {
+		ray.hit = false;
+		return false;
+	}
+
+	int dist = field[ray.mapY*stride + ray.mapX];
+
+	while (true) {
+		if (dist - 1 >= LEAP_MIN_RADIUS)
+			Leap(ray, std::min(dist, map.GetBorderDistance(ray.mapX, ray.mapY)) - 1);
+
+		if (std::min(ray.sideDistX, ray.sideDistY) >= ray.maxDist) {
+			ray.hit = false;
+			return false;
+		}
+
+		// jump to next map square, OR in x-direction, OR in y-direction
+		if (ray.sideDistX < ray.sideDistY) {
+			ray.sideDistX += ray.deltaDistX;
+			ray.mapX += ray.stepX;
+			ray.side = false;
+		} else {
+			ray.sideDistY += ray.deltaDistY;
+			ray.mapY += ray.stepY;
+			ray.side = true;
+		}
+
+		// the border around the map reads as a wall
+		dist = field[ray.mapY*stride + ray.mapX];
+		if (dist == 0) {
+			ray.hit = map.IsInside(ray.mapX, ray.mapY);
+			return ray.hit;
+		}
+	}
+}
+
+bool FixedCaster::InFog(const Map &map, const FixedRay &ray) {
+	return !ray.hit && map.IsInside(ray.mapX, ray.mapY);
+}
+
+Fixed FixedCaster::GetDistance(const FixedRay &ray, const Camera &cam, Fixed inset) {
+	// the face is the side of the cell the ray came in through
+	sf::Int64 plane, pos;
+	Fixed rayDir;
+
+	if (ray.side) {
+		plane = ((sf::Int64)ray.mapY << FIXED_SHIFT) + (ray.stepY < 0 ? FIXED_ONE : 0) + ray.stepY*inset;
+		pos = ToFixed(cam.position.y);
+		rayDir = ray.rayDirY;
+	} else {
+		plane = ((sf::Int64)ray.mapX << FIXED_SHIFT) + (ray.stepX < 0 ? FIXED_ONE : 0) + ray.stepX*inset;
+		pos = ToFixed(cam.position.x);
+		rayDir = ray.rayDirX;
+	}
+
+	if (rayDir == 0)
+		return FIXED_MAX_DELTA;
+
+	sf::Int64 d = ((plane - pos) << FIXED_SHIFT)/rayDir;
+	return (Fixed)std::max((sf::Int64)FIXED_MIN_DISTANCE, std::min(d, (sf::Int64)FIXED_MAX_DELTA));
+}
+
+Fixed FixedCaster::Sqrt(sf::Uint64 value) {
+	// a double estimate corrected to the exact floor, so rounding never shows in the result
+	sf::Uint64 root = (sf::Uint64)std::sqrt((double)value);
+
+	while (root*root > value)
+		root--;
+	while ((root + 1)*(root + 1) <= value)
+		root++;
+
+	return (Fixed)root;
+}
+
+#ifdef FIXEDCASTER_SIMD
+// rays are set up one at a time, then stepped in lock-step with the scalar comparisons and adds
+
+// leap the flagged lanes with the scalar code, through the rays themselves
+static void LeapLanes(const Map &map, FixedRay *rays, int lanes, int mask, int *sideDistX, int *sideDistY, int *mapX, int *mapY, const int *dist) {
+	for (int i=0; i<lanes; ++i) {
+		if (!(mask & (1 << i)))
+			continue;
+
+		FixedRay &ray = rays[i];
+		ray.sideDistX = sideDistX[i];
+		ray.sideDistY = sideDistY[i];
+		ray.mapX = mapX[i];
+		ray.mapY = mapY[i];
+
+		FixedCaster::Leap(ray, std::min(dist[i], map.GetBorderDistance(ray.mapX, ray.mapY)) - 1);
+
+		sideDistX[i] = ray.sideDistX;
+		sideDistY[i] = ray.sideDistY;
+		mapX[i] = ray.mapX;
+		mapY[i] = ray.mapY;
+	}
+}
+
+__attribute__((target("sse4.1")))
+static void TracePacketSSE(const Map &map, FixedRay *rays) {
+	const sf::Uint8 *field = map.GetDistanceField();
+
+	alignas(16) int in[8][4];
+	for (int i=0; i<4; ++i) {
+		in[0][i] = rays[i].deltaDistX;
+		in[1][i] = rays[i].deltaDistY;
+		in[2][i] = rays[i].sideDistX;
+		in[3][i] = rays[i].sideDistY;
+		in[4][i] = rays[i].mapX;
+		in[5][i] = rays[i].mapY;
+		in[6][i] = rays[i].stepX;
+		in[7][i] = rays[i].stepY;
+	}
+
+	__m128i deltaDistX = _mm_load_si128((const __m128i *)in[0]);
+	__m128i deltaDistY = _mm_load_si128((const __m128i *)in[1]);
+	__m128i sideDistX = _mm_load_si128((const __m128i *)in[2]);
+	__m128i sideDistY = _mm_load_si128((const __m128i *)in[3]);
+	__m128i mapX = _mm_load_si128((const __m128i *)in[4]);
+	__m128i mapY = _mm_load_si128((const __m128i *)in[5]);
+	__m128i stepX = _mm_load_si128((const __m128i *)in[6]);
+	__m128i stepY = _mm_load_si128((const __m128i *)in[7]);
+	__m128i maxDist = _mm_set1_epi32(rays[0].maxDist);
+
+	__m128i width = _mm_set1_epi32(map.GetWidth());
+	__m128i height = _mm_set1_epi32(map.GetHeight());
+	__m128i stride = _mm_set1_epi32(map.GetFieldStride());
+	__m128i minusOne = _mm_set1_epi32(-1);
+	__m128i leapMin = _mm_set1_epi32(LEAP_MIN_RADIUS);
+	__m128i dist = _mm_set1_epi32(field[rays[0].mapY*map.GetFieldStride() + rays[0].mapX]);
+
+	__m128i active = minusOne;
+	__m128i side = _mm_setzero_si128();
+	__m128i hit = _mm_setzero_si128();
+
+	alignas(16) int idx[4];
+	alignas(16) int check[4];
+	alignas(16) int lanes[5][4];
+
+	while (_mm_movemask_epi8(active)) {
+		// rays in wide empty squares leap across them
+		__m128i leap = _mm_and_si128(_mm_cmpgt_epi32(dist, leapMin), active);
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(leap));
+
+		if (mask) {
+			_mm_store_si128((__m128i *)lanes[0], sideDistX);
+			_mm_store_si128((__m128i *)lanes[1], sideDistY);
+			_mm_store_si128((__m128i *)lanes[2], mapX);
+			_mm_store_si128((__m128i *)lanes[3], mapY);
+			_mm_store_si128((__m128i *)lanes[4], dist);
+
+			LeapLanes(map, rays, 4, mask, lanes[0], lanes[1], lanes[2], lanes[3], lanes[4]);
+
+			sideDistX = _mm_load_si128((const __m128i *)lanes[0]);
+			sideDistY = _mm_load_si128((const __m128i *)lanes[1]);
+			mapX = _mm_load_si128((const __m128i *)lanes[2]);
+			mapY = _mm_load_si128((const __m128i *)lanes[3]);
+		}
+
+		// rays reaching the fog are done
+		active = _mm_and_si128(active, _mm_cmpgt_epi32(maxDist, _mm_min_epi32(sideDistX, sideDistY)));
+
+		// jump to next map square, OR in x-direction, OR in y-direction
+		__m128i xside = _mm_cmpgt_epi32(sideDistY, sideDistX);
+		__m128i mx = _mm_and_si128(xside, active);
+		__m128i my = _mm_andnot_si128(xside, active);
+
+		sideDistX = _mm_add_epi32(sideDistX, _mm_and_si128(deltaDistX, mx));
+		sideDistY = _mm_add_epi32(sideDistY, _mm_and_si128(deltaDistY, my));
+		mapX = _mm_add_epi32(mapX, _mm_and_si128(stepX, mx));
+		mapY = _mm_add_epi32(mapY, _mm_and_si128(stepY, my));
+		side = _mm_blendv_epi8(side, my, active);
+
+		_mm_store_si128((__m128i *)idx, _mm_add_epi32(_mm_mullo_epi32(mapY, stride), mapX));
+		_mm_store_si128((__m128i *)check, active);
+
+		dist = _mm_setr_epi32(
+			check[0] ? field[idx[0]] : 0,
+			check[1] ? field[idx[1]] : 0,
+			check[2] ? field[idx[2]] : 0,
+			check[3] ? field[idx[3]] : 0);
+		__m128i wall = _mm_and_si128(_mm_cmpeq_epi32(dist, _mm_setzero_si128()), active);
+
+		// rays reaching the border have left the map
+		if (_mm_movemask_epi8(wall)) {
+			__m128i inside = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(mapX, minusOne), _mm_cmpgt_epi32(width, mapX)),
+				_mm_and_si128(_mm_cmpgt_epi32(mapY, minusOne), _mm_cmpgt_epi32(height, mapY)));
+
+			hit = _mm_or_si128(hit, _mm_and_si128(wall, inside));
+			active = _mm_andnot_si128(wall, active);
+		}
+	}
+
+	alignas(16) int out[6][4];
+	_mm_store_si128((__m128i *)out[0], sideDistX);
+	_mm_store_si128((__m128i *)out[1], sideDistY);
+	_mm_store_si128((__m128i *)out[2], mapX);
+	_mm_store_si128((__m128i *)out[3], mapY);
+	_mm_store_si128((__m128i *)out[4], side);
+	_mm_store_si128((__m128i *)out[5], hit);
+
+	for (int i=0; i<4; ++i) {
+		rays[i].sideDistX = out[0][i];
+		rays[i].sideDistY = out[1][i];
+		rays[i].mapX = out[2][i];
+		rays[i].mapY = out[3][i];
+		rays[i].side = out[4][i] != 0;
+		rays[i].hit = out[5][i] != 0;
+	}
+}
+
+__attribute__((target("avx2")))
+static void TracePacketAVX2(const Map &map, FixedRay *rays) {
+	const sf::Uint8 *field = map.GetDistanceField();
+
+	alignas(32) int in[8][8];
+	for (int i=0; i<8; ++i) {
+		in[0][i] = rays[i].deltaDistX;
+		in[1][i] = rays[i].deltaDistY;
+		in[2][i] = rays[i].sideDistX;
+		in[3][i] = rays[i].sideDistY;
+		in[4][i] = rays[i].mapX;
+		in[5][i] = rays[i].mapY;
+		in[6][i] = rays[i].stepX;
+		in[7][i] = rays[i].stepY;
+	}
+
+	__m256i deltaDistX = _mm256_load_si256((const __m256i *)in[0]);
+	__m256i deltaDistY = _mm256_load_si256((const __m256i *)in[1]);
+	__m256i sideDistX = _mm256_load_si256((const __m256i *)in[2]);
+	__m256i sideDistY = _mm256_load_si256((const __m256i *)in[3]);
+	__m256i mapX = _mm256_load_si256((const __m256i *)in[4]);
+	__m256i mapY = _mm256_load_si256((const __m256i *)in[5]);
+	__m256i stepX = _mm256_load_si256((const __m256i *)in[6]);
+	__m256i stepY = _mm256_load_si256((const __m256i *)in[7]);
+	__m256i maxDist = _mm256_set1_epi32(rays[0].maxDist);
+
+	__m256i width = _mm256_set1_epi32(map.GetWidth());
+	__m256i height = _mm256_set1_epi32(map.GetHeight());
+	__m256i stride = _mm256_set1_epi32(map.GetFieldStride());
+	__m256i minusOne = _mm256_set1_epi32(-1);
+	__m256i zero = _mm256_setzero_si256();
+	__m256i leapMin = _mm256_set1_epi32(LEAP_MIN_RADIUS);
+	__m256i byte = _mm256_set1_epi32(0xFF);
+	__m256i dist = _mm256_set1_epi32(field[rays[0].mapY*map.GetFieldStride() + rays[0].mapX]);
+
+	__m256i active = minusOne;
+	__m256i side = zero;
+	__m256i hit = zero;
+
+	alignas(32) int lanes[5][8];
+
+	while (_mm256_movemask_epi8(active)) {
+		// rays in wide empty squares leap across them
+		__m256i leap = _mm256_and_si256(_mm256_cmpgt_epi32(dist, leapMin), active);
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(leap));
+
+		if (mask) {
+			_mm256_store_si256((__m256i *)lanes[0], sideDistX);
+			_mm256_store_si256((__m256i *)lanes[1], sideDistY);
+			_mm256_store_si256((__m256i *)lanes[2], mapX);
+			_mm256_store_si256((__m256i *)lanes[3], mapY);
+			_mm256_store_si256((__m256i *)lanes[4], dist);
+
+			LeapLanes(map, rays, 8, mask, lanes[0], lanes[1], lanes[2], lanes[3], lanes[4]);
+
+			sideDistX = _mm256_load_si256((const __m256i *)lanes[0]);
+			sideDistY = _mm256_load_si256((const __m256i *)lanes[1]);
+			mapX = _mm256_load_si256((const __m256i *)lanes[2]);
+			mapY = _mm256_load_si256((const __m256i *)lanes[3]);
+		}
+
+		// rays reaching the fog are done
+		active = _mm256_and_si256(active, _mm256_cmpgt_epi32(maxDist, _mm256_min_epi32(sideDistX, sideDistY)));
+
+		// jump to next map square, OR in x-direction, OR in y-direction
+		__m256i xside = _mm256_cmpgt_epi32(sideDistY, sideDistX);
+		__m256i mx = _mm256_and_si256(xside, active);
+		__m256i my = _mm256_andnot_si256(xside, active);
+
+		sideDistX = _mm256_add_epi32(sideDistX, _mm256_and_si256(deltaDistX, mx));
+		sideDistY = _mm256_add_epi32(sideDistY, _mm256_and_si256(deltaDistY, my));
+		mapX = _mm256_add_epi32(mapX, _mm256_and_si256(stepX, mx));
+		mapY = _mm256_add_epi32(mapY, _mm256_and_si256(stepY, my));
+		side = _mm256_blendv_epi8(side, my, active);
+
+		// gather the distances of the rays still going, a byte each
+		__m256i idx = _mm256_add_epi32(_mm256_mullo_epi32(mapY, stride), mapX);
+		dist = _mm256_and_si256(_mm256_mask_i32gather_epi32(zero, (const int *)field, idx, active, 1), byte);
+		__m256i wall = _mm256_and_si256(_mm256_cmpeq_epi32(dist, zero), active);
+
+		// rays reaching the border have left the map
+		if (_mm256_movemask_epi8(wall)) {
+			__m256i inside = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(mapX, minusOne), _mm256_cmpgt_epi32(width, mapX)),
+				_mm256_and_si256(_mm256_cmpgt_epi32(mapY, minusOne), _mm256_cmpgt_epi32(height, mapY)));
+
+			hit = _mm256_or_si256(hit, _mm256_and_si256(wall, inside));
+			active = _mm256_andnot_si256(wall, active);
+		}
+	}
+
+	alignas(32) int out[6][8];
+	_mm256_store_si256((__m256i *)out[0], sideDistX);
+	_mm256_store_si256((__m256i *)out[1], sideDistY);
+	_mm256_store_si256((__m256i *)out[2], mapX);
+	_mm256_store_si256((__m256i *)out[3], mapY);
+	_mm256_store_si256((__m256i *)out[4], side);
+	_mm256_store_si256((__m256i *)out[5], hit);
+
+	for (int i=0; i<8; ++i) {
+		rays[i].sideDistX = out[0][i];
+		rays[i].sideDistY = out[1][i];
+		rays[i].mapX = out[2][i];
+		rays[i].mapY = out[3][i];
+		rays[i].side = out[4][i] != 0;
+		rays[i].hit = out[5][i] != 0;
+	}
+}
+#endif
+
+void FixedCaster::TracePacket(const Map &map, const FixedRayTable &table, const Camera &cam, int x, FixedRay *rays) {
+	int width = RayCaster::GetPacketWidth();
+
+	for (int i=0; i<width; ++i)
+		Setup(table, cam, x + i, rays[i]);
+
+#ifdef FIXEDCASTER_SIMD
+	if (map.GetData() && map.IsInside(rays[0].mapX, rays[0].mapY)) {
+		if (RayCaster::GetMode() == PacketMode::AVX2) {
+			TracePacketAVX2(map, rays);
+			return;
+		} else if (RayCaster::GetMode() == PacketMode::SSE) {
+			TracePacketSSE(map, rays);
+			return;
+		}
+	}
+#endif
+
+	for (int i=0; i<width; ++i)
+		Trace(map, rays[i]);
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "Camera.hpp"
+#include "Map.hpp"
+
+// 16.16 fixed point
+typedef sf::Int32 Fixed;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define FIXED_HALF (FIXED_ONE/2)
+
+// cell crossing lengths of rays (nearly) along an axis are capped, so side distances stay in range
+#define FIXED_MAX_DELTA (1 << 28)
+
+// the nearest a wall is projected from, keeps column heights and texture steps in 32 bits
+#define FIXED_MIN_DISTANCE (FIXED_ONE/16)
+
+inline Fixed ToFixed(float f) {
+	return (Fixed)(f*FIXED_ONE);
+}
+
+// the state of one fixed point ray walking the grid, as Ray. side distances are along the view
+// direction rather than the ray, so the one a ray stops on is its perpendicular distance
+struct FixedRay {
+	Fixed	rayDirX;
+	Fixed	rayDirY;
+	Fixed	deltaDistX;
+	Fixed	deltaDistY;
+	Fixed	sideDistX;
+	Fixed	sideDistY;
+	Fixed	maxDist;		// the fog, nothing past it is stepped to
+
+	int		mapX;
+	int		mapY;
+	int		stepX;
+	int		stepY;
+
+	bool	side;
+	bool	hit;
+};
+
+// per-column fixed point rays, built from the camera rounded to 16.16 with integer arithmetic
+// only, so the same camera gives the same rays on any compiler or CPU
+class FixedRayTable {
+public:
+	FixedRayTable();
+
+	void Update(const Camera &cam, int screenWidth, float fogDistance);
+
+	int GetWidth() const;
+
+	const Fixed *GetRayDirX() const;
+	const Fixed *GetRayDirY() const;
+	const Fixed *GetDeltaDistX() const;
+	const Fixed *GetDeltaDistY() const;
+
+	// length of each ray, for the distance along it
+	const Fixed *GetLength() const;
+
+	Fixed GetMaxDist() const;
+
+private:
+	int					m_Width;
+	Fixed				m_Forward[2];
+	Fixed				m_Right[2];
+	Fixed				m_MaxDist;
+
+	std::vector<Fixed>	m_RayDirX;
+	std::vector<Fixed>	m_RayDirY;
+	std::vector<Fixed>	m_DeltaDistX;
+	std::vector<Fixed>	m_DeltaDistY;
+	std::vector<Fixed>	m_Length;
+};
+
+// the DDA of RayCaster in fixed point, in packets of the same width
+class FixedCaster {
+public:
+	static void Setup(const FixedRayTable &table, const Camera &cam, int x, FixedRay &ray);
+	static bool Trace(const Map &map, FixedRay &ray);
+
+	// as RayCaster::Leap, the crossings are counted exactly with integer divides
+	static void Leap(FixedRay &ray, int r);
+	static bool InFog(const Map &map, const FixedRay &ray);
+
+	static void TracePacket(const Map &map, const FixedRayTable &table, const Camera &cam, int x, FixedRay *rays);
+
+	// perpendicular distance to the face the ray stopped on, moved `inset` into the cell
+	static Fixed GetDistance(const FixedRay &ray, const Camera &cam, Fixed inset=0);
+
+	// square root of a 32.32 value as 16.16, rounded down
+	static Fixed Sqrt(sf::Uint64 value);
+};
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "FlatCaster.hpp"
+#include "ShadeTable.hpp"
+#include "Palette.hpp"
+#include "RayCaster.hpp"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FLATCASTER_SIMD
+#include <immintrin.h>
+#endif
+
+static int Log2(int n) {
+	int bits = 0;
+	while ((1 << bits) < n)
+		bits++;
+
+	return bits;
+}
+
+static bool IsPowerOfTwo(int n) {
+	return (n & (n - 1)) == 0;
+}
+
+// the texel a coordinate lands on. powers of two wrap with a mask, other sizes by the remainder of
+// the coordinate taken as signed, so a row running below zero carries on across the texture
+static inline int Wrap(sf::Uint32 coord, int size) {
+	if (IsPowerOfTwo(size))
+		return (int)((coord >> 16) & (size - 1));
+
+	int t = ((sf::Int32)coord >> 16) % size;
+	return t < 0 ? t + size : t;
+}
+
+sf::Uint32 FlatCaster::Sample(const FlatRow &row, const sf::Uint32 *texture, int texWidth, int texHeight, int x) {
+	int u = Wrap(row.u + x*row.du, texWidth);
+	int v = Wrap(row.v + x*row.dv, texHeight);
+
+	return ShadeTable::Apply(texture[u*texHeight + v], ShadeTable::Get(row.mod, false));
+}
+
+sf::Uint8 FlatCaster::Sample(const FlatRow &row, const sf::Uint8 *texture, int texWidth, int texHeight, int x) {
+	int u = Wrap(row.u + x*row.du, texWidth);
+	int v = Wrap(row.v + x*row.dv, texHeight);
+
+	return Palette::GetColormap(row.mod, false)[texture[u*texHeight + v]];
+}
+
+static void DrawSpanScalar(const FlatRow &row, const sf::Uint8 *texture, int texWidth, int texHeight,
+	const int *limit, bool floor, int y, sf::Uint8 *pixels, int xBegin, int xEnd)
+{
+	const sf::Uint8 *colormap = Palette::GetColormap(row.mod, false);
+
+	sf::Uint32 u = row.u + xBegin*row.du;
+	sf::Uint32 v = row.v + xBegin*row.dv;
+
+	for (int x = xBegin; x < xEnd; x++, u += row.du, v += row.dv) {
+		if (floor ? y < limit[x] : y >= limit[x])
+			continue;
+
+		int tu = Wrap(u, texWidth);
+		int tv = Wrap(v, texHeight);
+		pixels[x] = colormap[texture[tu*texHeight + tv]];
+	}
+}
+
+static void DrawSpanScalar(const FlatRow &row, const sf::Uint32 *texture, int texWidth, int texHeight,
+	const int *limit, bool floor, int y, sf::Uint32 *pixels, int xBegin, int xEnd)
+{
+	const sf::Uint8 *shade = ShadeTable::Get(row.mod, false);
+
+	sf::Uint32 u = row.u + xBegin*row.du;
+	sf::Uint32 v = row.v + xBegin*row.dv;
+
+	for (int x = xBegin; x < xEnd; x++, u += row.du, v += row.dv) {
+		if (floor ? y < limit[x] : y >= limit[x])
+			continue;
+
+		int tu = Wrap(u, texWidth);
+		int tv = Wrap(v, texHeight);
+		pixels[x] = ShadeTable::Apply(texture[tu*texHeight + tv], shade);
+	}
+}
+
+#ifdef FLATCASTER_SIMD
+// the packet paths shade with c*mod/255 worked out as (x + 1 + (x >> 8)) >> 8, exact for every
+// 16 bit product, so they match the shade table byte for byte
+
+__attribute__((target("sse4.1")))
+static __m128i ShadeSSE(__m128i texels, __m128i mod) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i one = _mm_set1_epi16(1);
+
+	__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(texels, zero), mod);
+	__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(texels, zero), mod);
+	lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+	hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+
+	// alpha is kept
+	return _mm_blendv_epi8(_mm_packus_epi16(lo, hi), texels, _mm_set1_epi32(0xFF000000));
+}
+
+__attribute__((target("sse4.1")))
+static void DrawSpanSSE(const FlatRow &row, const sf::Uint32 *texture, int texWidth, int texHeight,
+	const int *limit, bool floor, int y, sf::Uint32 *pixels, int xBegin, int xEnd)
+{
+	int vBits = Log2(texHeight);
+	__m128i uMask = _mm_set1_epi32(texWidth - 1);
+	__m128i vMask = _mm_set1_epi32(texHeight - 1);
+	__m128i mod = _mm_set1_epi16((short)row.mod);
+	__m128i yv = _mm_set1_epi32(y);
+	__m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+
+	__m128i u = _mm_add_epi32(_mm_set1_epi32(row.u + xBegin*row.du), _mm_mullo_epi32(lane, _mm_set1_epi32(row.du)));
+	__m128i v = _mm_add_epi32(_mm_set1_epi32(row.v + xBegin*row.dv), _mm_mullo_epi32(lane, _mm_set1_epi32(row.dv)));
+	__m128i du = _mm_set1_epi32(row.du*4);
+	__m128i dv = _mm_set1_epi32(row.dv*4);
+
+	alignas(16) int idx[4];
+
+	int x = xBegin;
+	for (; x + 4 <= xEnd; x += 4, u = _mm_add_epi32(u, du), v = _mm_add_epi32(v, dv)) {
+		// uncovered lanes, the rest keep what the walls wrote
+		__m128i above = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(limit + x)), yv);
+		__m128i mask = floor ? _mm_xor_si128(above, _mm_set1_epi32(-1)) : above;
+
+		if (_mm_testz_si128(mask, mask))
+			continue;
+
+		__m128i tu = _mm_and_si128(_mm_srli_epi32(u, 16), uMask);
+		__m128i tv = _mm_and_si128(_mm_srli_epi32(v, 16), vMask);
+		_mm_store_si128((__m128i *)idx, _mm_or_si128(_mm_slli_epi32(tu, vBits), tv));
+
+		__m128i texels = _mm_setr_epi32(texture[idx[0]], texture[idx[1]], texture[idx[2]], texture[idx[3]]);
+		__m128i dst = _mm_loadu_si128((const __m128i *)(pixels + x));
+		_mm_storeu_si128((__m128i *)(pixels + x), _mm_blendv_epi8(dst, ShadeSSE(texels, mod), mask));
+	}
+
+	DrawSpanScalar(row, texture, texWidth, texHeight, limit, floor, y, pixels, x, xEnd);
+}
+
+__attribute__((target("avx2")))
+static __m256i ShadeAVX2(__m256i texels, __m256i mod) {
+	__m256i zero = _mm256_setzero_si256();
+	__m256i one = _mm256_set1_epi16(1);
+
+	__m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(texels, zero), mod);
+	__m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(texels, zero), mod);
+	lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo, one), _mm256_srli_epi16(lo, 8)), 8);
+	hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(hi, one), _mm256_srli_epi16(hi, 8)), 8);
+
+	// unpack and pack both work within 128 bit halves, so the lanes come back in order
+	return _mm256_blendv_epi8(_mm256_packus_epi16(lo, hi), texels, _mm256_set1_epi32(0xFF000000));
+}
+
+__attribute__((target("avx2")))
+static void DrawSpanAVX2(const FlatRow &row, const sf::Uint32 *texture, int texWidth, int texHeight,
+	const int *limit, bool floor, int y, sf::Uint32 *pixels, int xBegin, int xEnd)
+{
+	int vBits = Log2(texHeight);
+	__m256i uMask = _mm256_set1_epi32(texWidth - 1);
+	__m256i vMask = _mm256_set1_epi32(texHeight - 1);
+	__m256i mod = _mm256_set1_epi16((short)row.mod);
+	__m256i yv = _mm256_set1_epi32(y);
+	__m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	__m256i u = _mm256_add_epi32(_mm256_set1_epi32(row.u + xBegin*row.du), _mm256_mullo_epi32(lane, _mm256_set1_epi32(row.du)));
+	__m256i v = _mm256_add_epi32(_mm256_set1_epi32(row.v + xBegin*row.dv), _mm256_mullo_epi32(lane, _mm256_set1_epi32(row.dv)));
+	__m256i du = _mm256_set1_epi32(row.du*8);
+	__m256i dv = _mm256_set1_epi32(row.dv*8);
+
+	int x = xBegin;
+	for (; x + 8 <= xEnd; x += 8, u = _mm256_add_epi32(u, du), v = _mm256_add_epi32(v, dv)) {
+		// uncovered lanes, the rest keep what the walls wrote
+		__m256i above = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(limit + x)), yv);
+		__m256i mask = floor ? _mm256_xor_si256(above, _mm256_set1_epi32(-1)) : above;
+
+		if (_mm256_testz_si256(mask, mask))
+			continue;
+
+		__m256i tu = _mm256_and_si256(_mm256_srli_epi32(u, 16), uMask);
+		__m256i tv = _mm256_and_si256(_mm256_srli_epi32(v, 16), vMask);
+		__m256i idx = _mm256_or_si256(_mm256_sllv_epi32(tu, _mm256_set1_epi32(vBits)), tv);
+
+		__m256i texels = _mm256_i32gather_epi32((const int *)texture, idx, 4);
+		__m256i dst = _mm256_loadu_si256((const __m256i *)(pixels + x));
+		_mm256_storeu_si256((__m256i *)(pixels + x), _mm256_blendv_epi8(dst, ShadeAVX2(texels, mod), mask));
+	}
+
+	DrawSpanScalar(row, texture, texWidth, texHeight, limit, floor, y, pixels, x, xEnd);
+}
+
+// the index versions look the texel and then its shade up one lane at a time on SSE, and with
+// byte gathers (4 bytes read, the low one kept) on AVX2
+
+__attribute__((target("sse4.1")))
+static void DrawSpanSSE(const FlatRow &row, const sf::Uint8 *texture, int texWidth, int texHeight,
+	const int *limit, bool floor, int y, sf::Uint8 *pixels, int xBegin, int xEnd)
+{
+	const sf::Uint8 *colormap = Palette::GetColormap(row.mod, false);
+	int vBits = Log2(texHeight);
+	__m128i uMask = _mm_set1_epi32(texWidth - 1);
+	__m128i vMask = _mm_set1_epi32(texHeight - 1);
+	__m128i yv = _mm_set1_epi32(y);
+	__m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+
+	__m128i u = _mm_add_epi32(_mm_set1_epi32(row.u + xBegin*row.du), _mm_mullo_epi32(lane, _mm_set1_epi32(row.du)));
+	__m128i v = _mm_add_epi32(_mm_set1_epi32(row.v + xBegin*row.dv), _mm_mullo_epi32(lane, _mm_set1_epi32(row.dv)));
+	__m128i du = _mm_set1_epi32(row.du*4);
+	__m128i dv = _mm_set1_epi32(row.dv*4);
+
+	alignas(16) int idx[4];
+
+	int x = xBegin;
+	for (; x + 4 <= xEnd; x += 4, u = _mm_add_epi32(u, du), v = _mm_add_epi32(v, dv)) {
+		__m128i above = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(limit + x)), yv);
+		__m128i mask = floor ? _mm_xor_si128(above, _mm_set1_epi32(-1)) : above;
+
+		if (_mm_testz_si128(mask, mask))
+			continue;
+
+		__m128i tu = _mm_and_si128(_mm_srli_epi32(u, 16), uMask);
+		__m128i tv = _mm_and_si128(_mm_srli_epi32(v, 16), vMask);
+		_mm_store_si128((__m128i *)idx, _mm_or_si128(_mm_slli_epi32(tu, vBits), tv));
+
+		// 4 lanes narrowed to the low 4 bytes
+		__m128i texels = _mm_setr_epi32(colormap[texture[idx[0]]], colormap[texture[idx[1]]], colormap[texture[idx[2]]], colormap[texture[idx[3]]]);
+		__m128i src = _mm_packus_epi32(texels, texels);
+		__m128i keep = _mm_packs_epi32(mask, mask);
+		src = _mm_packus_epi16(src, src);
+		keep = _mm_packs_epi16(keep, keep);
+
+		int dst;
+		std::memcpy(&dst, pixels + x, 4);
+		dst = _mm_cvtsi128_si32(_mm_blendv_epi8(_mm_cvtsi32_si128(dst), src, keep));
+		std::memcpy(pixels + x, &dst, 4);
+	}
+
+	DrawSpanScalar(row, texture, texWidth, texHeight, limit, floor, y, pixels, x, xEnd);
+}
+
+__attribute__((target("avx2")))
+static void DrawSpanAVX2(const FlatRow &row, const sf::Uint8 *texture, int texWidth, int texHeight,
+	const int *limit, bool floor, int y, sf::Uint8 *pixels, int xBegin, int xEnd)
+{
+	const int *colormap = (const int *)Palette::GetColormap(row.mod, false);
+	int vBits = Log2(texHeight);
+	__m256i uMask = _mm256_set1_epi32(texWidth - 1);
+	__m256i vMask = _mm256_set1_epi32(texHeight - 1);
+	__m256i byteMask = _mm256_set1_epi32(0xFF);
+	__m256i yv = _mm256_set1_epi32(y);
+	__m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	__m256i u = _mm256_add_epi32(_mm256_set1_epi32(row.u + xBegin*row.du), _mm256_mullo_epi32(lane, _mm256_set1_epi32(row.du)));
+	__m256i v = _mm256_add_epi32(_mm256_set1_epi32(row.v + xBegin*row.dv), _mm256_mullo_epi32(lane, _mm256_set1_epi32(row.dv)));
+	__m256i du = _mm256_set1_epi32(row.du*8);
+	__m256i dv = _mm256_set1_epi32(row.dv*8);
+
+	int x = xBegin;
+	for (; x + 8 <= xEnd; x += 8, u = _mm256_add_epi32(u, du), v = _mm256_add_epi32(v, dv)) {
+		__m256i above = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(limit + x)), yv);
+		__m256i mask = floor ? _mm256_xor_si256(above, _mm256_set1_epi32(-1)) : above;
+
+		if (_mm256_testz_si256(mask, mask))
+			continue;
+
+		__m256i tu = _mm256_and_si256(_mm256_srli_epi32(u, 16), uMask);
+		__m256i tv = _mm256_and_si256(_mm256_srli_epi32(v, 16), vMask);
+		__m256i idx = _mm256_or_si256(_mm256_sllv_epi32(tu, _mm256_set1_epi32(vBits)), tv);
+
+		__m256i texels = _mm256_and_si256(_mm256_i32gather_epi32((const int *)texture, idx, 1), byteMask);
+		__m256i shaded = _mm256_and_si256(_mm256_i32gather_epi32(colormap, texels, 1), byteMask);
+
+		// packs work within 128 bit halves, leaving lanes 0-3 and 4-7 in the low 4 bytes of each
+		__m256i src = _mm256_packus_epi32(shaded, shaded);
+		__m256i keep = _mm256_packs_epi32(mask, mask);
+		src = _mm256_packus_epi16(src, src);
+		keep = _mm256_packs_epi16(keep, keep);
+		__m128i src8 = _mm_unpacklo_epi32(_mm256_castsi256_si128(src), _mm256_extracti128_si256(src, 1));
+		__m128i keep8 = _mm_unpacklo_epi32(_mm256_castsi256_si128(keep), _mm256_extracti128_si256(keep, 1));
+
+		__m128i dst = _mm_loadl_epi64((const __m128i *)(pixels + x));
+		_mm_storel_epi64((__m128i *)(pixels + x), _mm_blendv_epi8(dst, src8, keep8));
+	}
+
+	DrawSpanScalar(row, texture, texWidth, texHeight, limit, floor, y, pixels, x, xEnd);
+}
+#endif
+
+void FlatCaster::DrawSpan(const FlatRow &row, const sf::Uint32 *texture, int texWidth, int texHeight,
+	const int *limit, bool floor, int y, sf::Uint32 *pixels, int xBegin, int xEnd)
+{
+#ifdef FLATCASTER_SIMD
+	// the packets mask and shift their texel indices
+	bool packets = IsPowerOfTwo(texWidth) && IsPowerOfTwo(texHeight);
+
+	if (packets && RayCaster::GetMode() == PacketMode::AVX2) {
+		DrawSpanAVX2(row, texture, texWidth, texHeight, limit, floor, y, pixels, xBegin, xEnd);
+		return;
+	} else if (packets && RayCaster::GetMode() == PacketMode::SSE) {
+		DrawSpanSSE(row, texture, texWidth, texHeight, limit, floor, y, pixels, xBegin, xEnd);
+		return;
+	}
+#endif
+
+	DrawSpanScalar(row, texture, texWidth, texHeight, limit, floor, y, pixels, xBegin, xEnd);
+}
+
+void FlatCaster::DrawSpan(const FlatRow &row, const sf::Uint8 *texture, int texWidth, int texHeight,
+	const int *limit, bool floor, int y, sf::Uint8 *pixels, int xBegin, int xEnd)
+{
+#ifdef FLATCASTER_SIMD
+	// the packets mask and shift their texel indices
+	bool packets = IsPowerOfTwo(texWidth) && IsPowerOfTwo(texHeight);
+
+	if (packets && RayCaster::GetMode() == PacketMode::AVX2) {
+		DrawSpanAVX2(row, texture, texWidth, texHeight, limit, floor, y, pixels, xBegin, xEnd);
+		return;
+	} else if (packets && RayCaster::GetMode() == PacketMode::SSE) {
+		DrawSpanSSE(row, texture, texWidth, texHeight, limit, floor, y, pixels, xBegin, xEnd);
+		return;
+	}
+#endif
+
+	DrawSpanScalar(row, texture, texWidth, texHeight, limit, floor, y, pixels, xBegin, xEnd);
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+// one screen row of floor or ceiling, texture coordinates in texels with 16 bits of fraction,
+// wrapping every texture, so every code path steps them with the same integer adds
+struct FlatRow {
+	sf::Uint32	u, v;		// at column 0
+	sf::Uint32	du, dv;		// per column
+	int			mod;		// distance shade, as in ShadeTable
+};
+
+// textured floor and ceiling spans, stepped along each row in packets picked like RayCaster's
+class FlatCaster {
+public:
+	// texture is a column-major texWidth x texHeight strip, stepped in packets when both are powers
+	// of two and a pixel at a time otherwise. the pixels of row y in [xBegin, xEnd) get a texel
+	// where the walls leave them uncovered, y < limit[x] for the ceiling and y >= limit[x] for the floor
+	static void DrawSpan(const FlatRow &row, const sf::Uint32 *texture, int texWidth, int texHeight,
+		const int *limit, bool floor, int y, sf::Uint32 *pixels, int xBegin, int xEnd);
+
+	// the same for a single pixel, for column-wise fills
+	static sf::Uint32 Sample(const FlatRow &row, const sf::Uint32 *texture, int texWidth, int texHeight, int x);
+
+	// the same for Palette indices, shaded through a colormap. the texture needs PALETTE_GATHER_PAD
+	// bytes after it, as the packet paths gather 4 bytes at a time
+	static void DrawSpan(const FlatRow &row, const sf::Uint8 *texture, int texWidth, int texHeight,
+		const int *limit, bool floor, int y, sf::Uint8 *pixels, int xBegin, int xEnd);
+	static sf::Uint8 Sample(const FlatRow &row, const sf::Uint8 *texture, int texWidth, int texHeight, int x);
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "FrameBuffer.hpp"
+
+#include <algorithm>
+#include <limits>
+
+FrameBuffer::FrameBuffer()
+	: m_Width(0), m_Height(0)
+{
+
+}
+
+FrameBuffer::FrameBuffer(int width, int height)
+	: m_Width(0), m_Height(0)
+{
+	Create(width, height);
+}
+
+void FrameBuffer::Create(int width, int height) {
+	m_Width = width;
+	m_Height = height;
+
+	m_Pixels.assign(width*height, 0);
+	m_Indices.assign(width*height, 0);
+	m_Depth.assign(width, std::numeric_limits<float>::max());
+}
+
+void FrameBuffer::Clear(const sf::Color &color) {
+	std::fill(m_Pixels.begin(), m_Pixels.end(), PackColor(color));
+	std::fill(m_Depth.begin(), m_Depth.end(), std::numeric_limits<float>::max());
+}
+
+int FrameBuffer::GetWidth() const {
+	return m_Width;
+}
+
+int FrameBuffer::GetHeight() const {
+	return m_Height;
+}
+
+sf::Uint32 *FrameBuffer::GetPixels() {
+	return m_Pixels.data();
+}
+
+const sf::Uint32 *FrameBuffer::GetPixels() const {
+	return m_Pixels.data();
+}
+
+sf::Uint8 *FrameBuffer::GetIndices() {
+	return m_Indices.data();
+}
+
+const sf::Uint8 *FrameBuffer::GetIndices() const {
+	return m_Indices.data();
+}
+
+float *FrameBuffer::GetDepthBuffer() {
+	return m_Depth.data();
+}
+
+const float *FrameBuffer::GetDepthBuffer() const {
+	return m_Depth.data();
+}
+
+sf::Color FrameBuffer::GetPixel(int x, int y) const {
+	return UnpackColor(m_Pixels[y*m_Width + x]);
+}
+
+void FrameBuffer::SetPixel(int x, int y, const sf::Color &color) {
+	m_Pixels[y*m_Width + x] = PackColor(color);
+}
+
+void FrameBuffer::CopyToImage(sf::Image &image) const {
+	image.create(m_Width, m_Height, (const sf::Uint8 *)m_Pixels.data());
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+// pack an sf::Color into a pixel, keeping the RGBA byte order sf::Image and sf::Texture use
+inline sf::Uint32 PackColor(const sf::Color &c) {
+	sf::Uint32 p;
+	sf::Uint8 *b = (sf::Uint8 *)&p;
+	b[0] = c.r;
+	b[1] = c.g;
+	b[2] = c.b;
+	b[3] = c.a;
+
+	return p;
+}
+
+inline sf::Color UnpackColor(sf::Uint32 p) {
+	const sf::Uint8 *b = (const sf::Uint8 *)&p;
+	return sf::Color(b[0], b[1], b[2], b[3]);
+}
+
+class FrameBuffer {
+public:
+	FrameBuffer();
+	FrameBuffer(int width, int height);
+
+	void Create(int width, int height);
+	void Clear(const sf::Color &color);
+
+	int GetWidth() const;
+	int GetHeight() const;
+
+	sf::Uint32 *GetPixels();
+	const sf::Uint32 *GetPixels() const;
+
+	// the 8-bit frame of the palettized pipeline, one index per pixel laid out like the pixels
+	sf::Uint8 *GetIndices();
+	const sf::Uint8 *GetIndices() const;
+
+	float *GetDepthBuffer();
+	const float *GetDepthBuffer() const;
+
+	sf::Color GetPixel(int x, int y) const;
+	void SetPixel(int x, int y, const sf::Color &color);
+
+	void CopyToImage(sf::Image &image) const;
+
+private:
+	int						m_Width;
+	int						m_Height;
+
+	std::vector<sf::Uint32>	m_Pixels;
+	std::vector<sf::Uint8>	m_Indices;
+	std::vector<float>		m_Depth;
+};
\ No newline at end of file
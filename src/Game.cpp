@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <stdexcept>
 
 #include "Game.hpp"
 #include "ResourceLoader.hpp"
@@ -11,18 +12,21 @@
 #include "Weapons/Shotgun.hpp"
 #include "Weapons/Pistol.hpp"
 
-#define TEX_WIDTH 64
-#define TEX_HEIGHT 64
 #define FOV 65
 
+// wall sheet textures laid over the floor and ceiling
+#define FLOOR_TEXTURE 42
+#define CEILING_TEXTURE 1
+
 #define PI 3.14159265359f
 
-Game::Game(sf::RenderWindow *win)
-	:	m_Window(win), m_ScreenWidth(win->getSize().x), m_ScreenHeight(win->getSize().y),
-		m_Map("Maps/E1M1.rcm", &m_Player),
+Game::Game(sf::RenderWindow *win, int threads)
+	:	m_ThreadPool(threads), m_Window(win), m_ScreenWidth(win->getSize().x), m_ScreenHeight(win->getSize().y),
+		m_Map("Maps/E1M1.rcm", &m_Player, &m_ThreadPool),
 		m_Player(&m_Map, sf::Vector2f(14.5f, 8.5f), sf::Vector2f(0.f, -1.f), FOV*PI/180.f), 
 		m_MouseCaptured(true), m_Paused(false),
-		m_Weapon(new Pistol(&m_Player))
+		m_Renderer(m_ScreenWidth, m_ScreenHeight),
+		m_HitCell(-1), m_Weapon(new Pistol(&m_Player))
 {
 	// set up weapon ammo types
 	Weapon::AmmoTypes["Pistol"] = 100;
@@ -30,20 +34,27 @@ Game::Game(sf::RenderWindow *win)
 	m_Player.SetAmmo("Pistol", 10);
 	m_Player.SetAmmo("Shotgun", 10);
 
-	// buffers
-	m_Buffer.create(m_ScreenWidth, m_ScreenWidth);
-	m_DepthBuffer = new float[m_ScreenWidth];
+	// renderer splits its passes over the worker threads
+	m_Renderer.SetThreadPool(&m_ThreadPool);
+
+	// screen texture, the frame buffer is uploaded into its top left corner every frame and
+	// stretched over the window with nearest sampling
+	m_ScreenTexture.create(m_ScreenWidth, m_ScreenHeight);
+	m_ScreenTexture.setSmooth(false);
+
+	m_Map.SetFloorTexture(FLOOR_TEXTURE);
+	m_Map.SetCeilingTexture(CEILING_TEXTURE);
 
 	// test animated sprites
 	Animation<int> anim(3);
 	anim.InsertFrame(1);
 	anim.InsertFrame(2);
 
-	m_Map.AddSprite(new Sprite(ResourceLoader::GetTexture("Images/barrel.png"), anim, sf::Vector2u(23,32), sf::Vector2f(6.5f, 8.5f), 0.4f, 0.f));
-	m_Map.AddSprite(new Sprite(ResourceLoader::GetTexture("Images/barrel.png"), anim, sf::Vector2u(23,32), sf::Vector2f(6.5f, 9.5f), 0.4f, 0.f));
+	m_Map.AddSprite(new Sprite(ResourceLoader::GetSpriteSheet("Images/barrel.png", sf::Vector2u(23,32)), anim, sf::Vector2f(6.5f, 8.5f), 0.4f, 0.f));
+	m_Map.AddSprite(new Sprite(ResourceLoader::GetSpriteSheet("Images/barrel.png", sf::Vector2u(23,32)), anim, sf::Vector2f(6.5f, 9.5f), 0.4f, 0.f));
 
 	// test directional sprites
-	m_Map.AddSprite(new Sprite(ResourceLoader::GetTexture("Images/Monsters/imp.png"), sf::Vector2u(41, 57), sf::Vector2f(10.f, 13.f), 0.65f, 0.f, true));
+	m_Map.AddSprite(new Sprite(ResourceLoader::GetSpriteSheet("Images/Monsters/imp.png", sf::Vector2u(41, 57)), sf::Vector2f(10.f, 13.f), 0.65f, 0.f, true));
 	
 	// test directional animated sprites
 	Animation<int> canim(6);
@@ -53,7 +64,7 @@ Game::Game(sf::RenderWindow *win)
 	canim.InsertFrame(4);
 	canim.InsertFrame(1);
 
-	m_Map.AddSprite(new Sprite(ResourceLoader::GetTexture("Images/Monsters/cacodemon.png"), canim, sf::Vector2u(76, 78), sf::Vector2f(15.f, 8.f), 0.8f, 0.5f, true));
+	m_Map.AddSprite(new Sprite(ResourceLoader::GetSpriteSheet("Images/Monsters/cacodemon.png", sf::Vector2u(76, 78)), canim, sf::Vector2f(15.f, 8.f), 0.8f, 0.5f, true));
 
 	// start game music
 	m_Music.openFromFile("Music/E1M1.wav");
@@ -65,9 +76,6 @@ Game::Game(sf::RenderWindow *win)
 }
 
 Game::~Game() {
-	// delete depth buffer
-	delete[] m_DepthBuffer;
-
 	// shutdown resource loader
 	ResourceLoader::ShutDown();
 
@@ -111,326 +119,69 @@ void Game::Tick(float dt) {
 }
 
 void Game::Draw() {
-	// wall image
-	const sf::Image *wall = m_Map.GetWallImage();
-
 	const sf::Vector2f &pos = m_Player.GetPosition();
-	const sf::Vector2f &look = m_Player.GetForward();
-	const sf::Vector2f &right = m_Player.GetRight();
-
-	int fpHeight = int(256.f*m_Player.GetHeight());
-
-	m_Window->clear(m_Map.GetFloorColor()); // clear to the floor color
-	for (int x=0; x<m_ScreenWidth; ++x) { // clear the buffer and depth buffer
-		m_DepthBuffer[x] = std::numeric_limits<float>::max();
+	Camera cam = m_Player.GetCamera();
 
-		for (int y=0; y<m_ScreenHeight; ++y)
-			m_Buffer.setPixel(x, y, sf::Color::Transparent);
-	}
-
-	// draw the ceiling
-	sf::RectangleShape crect(sf::Vector2f((float)m_ScreenWidth, m_ScreenHeight/2.f));
-	crect.setFillColor(m_Map.GetCeilingColor());
-	crect.setOutlineThickness(0.f);
-	m_Window->draw(crect);
-
-	// DDA ray casting (WALL CASTING)
-	for (int x = 0; x < m_ScreenWidth; x++) {
-		// calculate ray position and direction 
-		float cameraX = 2.f*x/float(m_ScreenWidth)-1.f; //x-coordinate in camera space     
-		float rayDirX = look.x + right.x*cameraX;
-		float rayDirY = look.y + right.y*cameraX;
-     
-		// cast a ray
-		bool hit = false;
-		bool side = false; // EASTWEST = false
-		WallSide cardinal;
-		float perpdist = 0.f;
-		float dist = 0.f;
-		sf::Vector2f hitpos;
-
-		// which box of the map we're in  
-		int mapX = int(pos.x);
-		int mapY = int(pos.y);
-       
-		// length of ray from current position to next x or y-side
-		float sideDistX;
-		float sideDistY;
-       
-		// length of ray from one x or y-side to next x or y-side
-		float deltaDistX = std::sqrt(1 + (rayDirY * rayDirY) / (rayDirX * rayDirX));
-		float deltaDistY = std::sqrt(1 + (rayDirX * rayDirX) / (rayDirY * rayDirY));
-       
-		// what direction to step in x or y-direction (either +1 or -1)
-		int stepX;
-		int stepY;
-
-		// calculate step and initial sideDist
-		if (rayDirX < 0) {
-			stepX = -1;
-			sideDistX = (pos.x - mapX) * deltaDistX;
-		} else {
-			stepX = 1;
-			sideDistX = (mapX + 1.0f - pos.x) * deltaDistX;
-		}  
-			
-		if (rayDirY < 0) {
-			stepY = -1;
-			sideDistY = (pos.y - mapY) * deltaDistY;
-		} else {
-			stepY = 1;
-			sideDistY = (mapY + 1.0f - pos.y) * deltaDistY;
-		}
-
-		// perform DDA
-		while (true) {
-			// jump to next map square, OR in x-direction, OR in y-direction
-			if (sideDistX < sideDistY) {
-				sideDistX += deltaDistX;
-				mapX += stepX;
-				side = false;
-
-				if (stepX < 0)
-					cardinal = WallSide::EAST;
-				else
-					cardinal = WallSide::WEST;
-			} else {
-				sideDistY += deltaDistY;
-				mapY += stepY;
-				side = true;
-
-				if (stepY < 0)
-					cardinal = WallSide::NORTH;
-				else
-					cardinal = WallSide::SOUTH;
-			}
-
-			// Check if ray is out of bounds
-			if (mapX < 0 || mapX >= m_Map.GetWidth() || mapY < 0 || mapY >= m_Map.GetHeight())
-				break;
+	sf::Clock clock;
 
-			// Check if ray has hit a wall
-			//int type = m_Map.Get(mapX, mapY);
-			if (m_Map.IsWall(mapX, mapY)) {
-				hit = true;
+	// cast the walls into the frame buffer
+	m_Renderer.Render(m_Map, cam);
+	const ColumnHit &hit = m_Renderer.GetColumnHit(m_Renderer.GetWidth()/2);
+	m_HitCell = hit.cell;
+	m_HitCoords = hit.position;
+	m_HitSide = hit.face;
 
-				if (side) {
-					hitpos.x = pos.x + ((mapY - pos.y + (1 - stepY) / 2) / rayDirY) * rayDirX;
-					hitpos.y = (float)mapY;
-
-					perpdist += std::abs((mapY - pos.y + (1 - stepY) / 2) / rayDirY);
-				} else {
-					hitpos.y = pos.y + ((mapX - pos.x + (1 - stepX) / 2) / rayDirX) * rayDirY;
-					hitpos.x = (float)mapX;
-
-					perpdist += std::abs((mapX - pos.x + (1 - stepX) / 2) / rayDirX);
-				}
+	// sort sprites based on player position and composite them over the walls
+	m_Map.SortSprites(pos);
+	m_Renderer.DrawSprites(m_Map.GetSprites(), cam);
 
-				dist += std::sqrt(std::pow(hitpos.x - pos.x, 2.f) + std::pow(hitpos.y - pos.y, 2.f));
-				
-				// the ray hit a door
-				if (m_Map.IsDoor(mapX, mapY)) {
-					if (m_Map.IsOpen(mapX, mapY)) {
-						hit = false;
-						perpdist = 0.f;
-						dist = 0.f;
-						continue;
-					}
+	float ms = clock.getElapsedTime().asMicroseconds()/1000.f;
 
-					// move ray on by inset
-					float inset = 0.5f;
-
-					float dhitposx = hitpos.x;
-					float dhitposy = hitpos.y;
-					int dmapX = mapX;
-					int dmapY = mapY;
-					float p;
-
-					if (side) {
-						float c = stepX*inset*std::abs(rayDirX/rayDirY);
-						p = std::sqrt(inset*inset + c*c);
-						dhitposx += c;
-
-						float amount;
-						if (m_Map.IsMoving(mapX, mapY, amount) && dhitposx > (float)mapX) {
-							dhitposx += amount;
-						}
-
-						// flip the texture for back faces
-						if (stepY > 0)
-							dhitposx = (float)std::floor(mapX) + (1.f - (dhitposx - (float)std::floor(mapX)));
-
-						dmapX = (int)dhitposx;
-					} else {
-						float c = stepY*inset*std::abs(rayDirY/rayDirX);
-						p = std::sqrt(inset*inset + c*c);
-						dhitposy += c;
-
-						float amount;
-						if (m_Map.IsMoving(mapX, mapY, amount) && dhitposy > (float)mapY) {
-							dhitposy += amount;
-						}
-
-						// flip the texture for back faces
-						if (stepX < 0)
-							dhitposy = (float)std::floor(mapY) + (1.f - (dhitposy - (float)std::floor(mapY)));
-
-						dmapY = (int)dhitposy;
-					}
-					
-					// if it is still hitting the door, draw it
-					if (dmapX == mapX && dmapY == mapY) {
-						hitpos.x = dhitposx;
-						hitpos.y = dhitposy;
-						mapX = (int)dhitposx;
-						mapY = (int)dhitposy;
-
-						// extend perpdist
-						perpdist += p*std::cos((x - m_ScreenWidth/2)*((FOV*PI/180.f)/(float)m_ScreenWidth));
-					} else { // otherwise, carry on
-						hit = false;
-						perpdist = 0.f;
-						dist = 0.f;
-						continue;
-					}
-				}
-				break;
-			}	
-		}
+	// one upload straight from the frame buffer, scaled up to the window
+	int w = m_Renderer.GetWidth();
+	int h = m_Renderer.GetHeight();
 
-		if (hit) {
-			if (x == m_ScreenWidth/2) {
-				m_HitCoords.x = hitpos.x;
-				m_HitCoords.y = hitpos.y;
+	m_ScreenTexture.update((const sf::Uint8 *)m_Renderer.GetFrameBuffer().GetPixels(), w, h, 0, 0);
 
-				m_HitSide = cardinal;
-			}
-       
-			// write to depth buffer
-			m_DepthBuffer[x] = std::min(m_DepthBuffer[x], perpdist);
-        
-			// Calculate height of line to draw on screen
-			int lineHeight = std::abs(int(m_ScreenHeight / perpdist));
-
-			// calculate lowest and highest pixel to fill in current stripe
-			int drawStart = -int(lineHeight*(1-m_Player.GetHeight())) + m_ScreenHeight/2;
-			if (drawStart < 0)
-				drawStart = 0;
-
-			int drawEnd = int(lineHeight*(m_Player.GetHeight())) + m_ScreenHeight/2;
-			if (drawEnd >= m_ScreenHeight)
-				drawEnd = m_ScreenHeight - 1;
-
-			// texturing calculations
-			int texNum;
-			switch (cardinal) {
-				case WallSide::NORTH:
-					texNum = m_Map.Get((int)hitpos.x, (int)hitpos.y).north - 1; break;
-				case WallSide::EAST:
-					texNum = m_Map.Get((int)hitpos.x, (int)hitpos.y).east - 1; break;
-				case WallSide::SOUTH:
-					texNum = m_Map.Get((int)hitpos.x, (int)hitpos.y).south - 1; break;
-				case WallSide::WEST:
-					texNum = m_Map.Get((int)hitpos.x, (int)hitpos.y).west - 1; break;
-				default:
-					texNum = 1;
-			}
+	sf::Sprite screen(m_ScreenTexture, sf::IntRect(0, 0, w, h));
+	screen.setScale((float)m_ScreenWidth/w, (float)m_ScreenHeight/h);
+	m_Window->draw(screen);
 
-			int texNumX = texNum%3; // N%W
-			int texNumY = (texNum - texNumX)/3; // (N-X)/W
-       
-			// calculate value of wallX
-			float hitX = (side ? hitpos.x : hitpos.y);
-			float wallX = hitX - std::floor((hitX));
-       
-			// x coordinate on the texture
-			int texX = int(wallX * float(TEX_WIDTH));
-			if (!side && rayDirX > 0)
-				texX = TEX_WIDTH - texX - 1;
-			if (side && rayDirY < 0)
-				texX = TEX_WIDTH - texX - 1;
-
-			int mod = int(255.f*std::max(0.f, 1.f - dist/25.f));
-			for (int y = drawStart; y < drawEnd; y++) {
-				int d = y*256 - m_ScreenHeight*128 + lineHeight*(256 - fpHeight);
-				int texY = ((d * TEX_HEIGHT) / lineHeight) / 256;
-				sf::Color color = wall->getPixel(texX + TEX_WIDTH*texNumX, texY + TEX_HEIGHT*texNumY);
-
-				// make distant walls darker
-				color *= sf::Color(mod, mod, mod);
-
-				// make color darker for y-sides
-				if (side)
-					color *= sf::Color(170, 170, 170);
-
-				m_Buffer.setPixel(x, y, color);
-			}
-		} else {
-			m_HitCoords.x = -1;
-			m_HitCoords.y = -1;
-		}
+	// next frame renders at whatever size holds the target
+	if (m_Governor.Update(ms)) {
+		sf::Vector2u size = m_Governor.GetResolution(sf::Vector2u(m_ScreenWidth, m_ScreenHeight));
+		m_Renderer.SetSize(size.x, size.y);
 	}
 
-	m_ScreenTexture.loadFromImage(m_Buffer);
-	m_Window->draw(sf::Sprite(m_ScreenTexture));
-
-	// SPRITE CASTING
-	// sort sprites based on player position
-	m_Map.SortSprites(pos);
-
-	// draw sprites
-	for (Sprite *sprite : m_Map.GetSprites()) {
-		sf::Sprite bspr(*sprite->GetTexture());
-		const sf::Vector2u &size = sprite->GetSize();
-
-		float spriteX = sprite->GetPosition().x - pos.x;
-		float spriteY = sprite->GetPosition().y - pos.y;
-
-		if (look.x*spriteX + look.y*spriteY > 0) {
-			float invDet = 1.0f / (right.x * look.y - look.x * right.y);
-			float transformX = invDet * (look.y * spriteX - look.x * spriteY);
-			float transformY = invDet * (-right.y * spriteX + right.x * spriteY);
-
-			if (transformY > 0) {            
-				float height = (float)std::abs(int(m_ScreenHeight / transformY));
-				int spriteScreenX = int((m_ScreenWidth / 2) * (1 + transformX / transformY));
-				int spriteScreenY = int(m_ScreenHeight/2 + height*(m_Player.GetHeight() - sprite->GetScale()/2.f - (1.f - sprite->GetScale())*sprite->GetFloatHeight()));
-				height *= sprite->GetScale();
-
-				int spriteWidth = int(size.x*(height/size.y));
-				int drawStartX = -spriteWidth/2 + spriteScreenX;
-				if (drawStartX < 0)
-					drawStartX = 0;
+	// draw gun
+	m_Weapon->Draw(m_Window);
+}
 
-				int drawEndX = spriteWidth / 2 + spriteScreenX;
-				if (drawEndX >= m_ScreenWidth)
-					drawEndX = m_ScreenWidth - 1;
+void Game::SetFrameTimeTarget(float ms) {
+	m_Governor.SetTarget(ms);
 
-				for (int x=drawStartX; x<drawEndX; ++x) {
-					if (x >= 0 && x < m_ScreenWidth && m_DepthBuffer[x] > transformY) {
-						int texX = int((x - (-spriteWidth / 2 + spriteScreenX))*size.x/spriteWidth);
+	sf::Vector2u size = m_Governor.GetResolution(sf::Vector2u(m_ScreenWidth, m_ScreenHeight));
+	m_Renderer.SetSize(size.x, size.y);
+}
 
-						sf::IntRect t = sprite->GetTextureRect();
-						bspr.setTextureRect(sf::IntRect(t.left + texX, t.top, 1, size.y));
+const ResolutionGovernor &Game::GetGovernor() const {
+	return m_Governor;
+}
 
-						bspr.setOrigin(0.f, size.y/2.f);
-						bspr.setScale(1.f, height/size.y);
-						bspr.setPosition((float)x, (float)spriteScreenY);
+void Game::SetWallMode(WallMode mode) {
+	m_Renderer.SetWallMode(mode);
+}
 
-						// darken based on distance
-						float dist = std::sqrt(std::pow(pos.x - sprite->GetPosition().x, 2.f) + std::pow(pos.y - sprite->GetPosition().y, 2.f));
-						int mod = int(255.f*std::max(0.f, 1.f - dist/25.f));
-						bspr.setColor(sf::Color(mod, mod, mod));
+void Game::SetPalettized(bool palettized) {
+	m_Renderer.SetPalettized(palettized);
+}
 
-						m_Window->draw(bspr);
-					}
-				}
-			}
-		}
-	}
+void Game::SetFixedPoint(bool fixedPoint) {
+	m_Renderer.SetFixedPoint(fixedPoint);
+}
 
-	// draw gun
-	m_Weapon->Draw(m_Window);
+void Game::SetFogDistance(float fogDistance) {
+	m_Renderer.SetFogDistance(fogDistance);
 }
 
 void Game::HandleEvent(const sf::Event &ev) {
@@ -454,9 +205,23 @@ void Game::HandleEvent(const sf::Event &ev) {
 			} else if (ev.key.code == sf::Keyboard::Num2) {
 				delete m_Weapon;
 				m_Weapon = new Shotgun(&m_Player);
+			} else if (ev.key.code == sf::Keyboard::F1) {
+				// a file that fails to load leaves the map as it was
+				try {
+					m_Map.Reload();
+				} catch (const std::runtime_error &e) {
+					std::cerr << "Could not reload the map: " << e.what() << std::endl;
+				}
+			} else if (ev.key.code == sf::Keyboard::F2) {
+				try {
+					m_Map.Save();
+				} catch (const std::runtime_error &e) {
+					std::cerr << "Could not save the map: " << e.what() << std::endl;
+				}
+			} else if (m_HitCell == -1) {
+				// the keys below act on the cell in the middle of the view, there is none
 			} else if (ev.key.code == sf::Keyboard::Space) {
-				sf::Vector2i mappos = sf::Vector2i((int)m_HitCoords.x, (int)m_HitCoords.y);
-				int mapi = mappos.y*m_Map.GetWidth() + mappos.x;
+				int mapi = m_HitCell;
 
 				if (m_Map.IsDoor(mapi) && !m_Map.IsMoving(mapi)) {
 					const sf::Vector2f &pos = m_Player.GetPosition();
@@ -467,7 +232,7 @@ void Game::HandleEvent(const sf::Event &ev) {
 					}
 				}
 			} else if (ev.key.code == sf::Keyboard::Up) {
-				sf::Vector2i mappos = sf::Vector2i((int)m_HitCoords.x, (int)m_HitCoords.y);
+				sf::Vector2i mappos = sf::Vector2i(m_HitCell % m_Map.GetWidth(), m_HitCell / m_Map.GetWidth());
 				Wall w = m_Map.Get(mappos.x, mappos.y);
 
 				switch (m_HitSide) {
@@ -483,7 +248,7 @@ void Game::HandleEvent(const sf::Event &ev) {
 
 				m_Map.Set(mappos.x, mappos.y, w);
 			} else if (ev.key.code == sf::Keyboard::Down) {
-				sf::Vector2i mappos = sf::Vector2i((int)m_HitCoords.x, (int)m_HitCoords.y);
+				sf::Vector2i mappos = sf::Vector2i(m_HitCell % m_Map.GetWidth(), m_HitCell / m_Map.GetWidth());
 				Wall w = m_Map.Get(mappos.x, mappos.y);
 				
 				switch (m_HitSide) {
@@ -499,7 +264,7 @@ void Game::HandleEvent(const sf::Event &ev) {
 
 				m_Map.Set(mappos.x, mappos.y, w);
 			} else if (ev.key.code == sf::Keyboard::C) {
-				sf::Vector2i mappos = sf::Vector2i((int)m_HitCoords.x, (int)m_HitCoords.y);
+				sf::Vector2i mappos = sf::Vector2i(m_HitCell % m_Map.GetWidth(), m_HitCell / m_Map.GetWidth());
 
 				switch (m_HitSide) {
 					case WallSide::NORTH:
@@ -512,23 +277,22 @@ void Game::HandleEvent(const sf::Event &ev) {
 						mappos.x -= 1; break;
 				}
 
-				Wall w;
-				w.flags |= (int)WallFlags::COLLIDE;
-				w.north = w.south = w.east = w.west = 1;
-				m_Map.Set(mappos.x, mappos.y, w);
+				// the face may be on the edge of the map
+				if (m_Map.IsInside(mappos.x, mappos.y)) {
+					Wall w;
+					w.flags |= (int)WallFlags::COLLIDE;
+					w.north = w.south = w.east = w.west = 1;
+					m_Map.Set(mappos.x, mappos.y, w);
+				}
 			} else if (ev.key.code == sf::Keyboard::X) {
-				sf::Vector2i mappos = sf::Vector2i((int)m_HitCoords.x, (int)m_HitCoords.y);
+				sf::Vector2i mappos = sf::Vector2i(m_HitCell % m_Map.GetWidth(), m_HitCell / m_Map.GetWidth());
 				m_Map.Set(mappos.x, mappos.y, Wall());
 			} else if (ev.key.code == sf::Keyboard::M) {
-				sf::Vector2i mappos = sf::Vector2i((int)m_HitCoords.x, (int)m_HitCoords.y);
+				sf::Vector2i mappos = sf::Vector2i(m_HitCell % m_Map.GetWidth(), m_HitCell / m_Map.GetWidth());
 				Wall w = m_Map.Get(mappos.x, mappos.y);
 
 				w.flags ^= (int)WallFlags::DOOR;
 				m_Map.Set(mappos.x, mappos.y, w);
-			} else if (ev.key.code == sf::Keyboard::F1) {
-				m_Map.Reload();
-			} else if (ev.key.code == sf::Keyboard::F2) {
-				m_Map.Save();
 			}
 
 			break;
@@ -7,17 +7,12 @@
 #include "Sprite.hpp"
 #include "Map.hpp"
 #include "Weapon.hpp"
-
-enum struct WallSide {
-	NORTH,
-	EAST,
-	SOUTH,
-	WEST
-};
+#include "Renderer.hpp"
+#include "ResolutionGovernor.hpp"
 
 class Game {
 public:
-	Game(sf::RenderWindow *win);
+	Game(sf::RenderWindow *win, int threads);
 	~Game();
 
 	void SetMouseCaptured(bool b);
@@ -28,12 +23,24 @@ public:
 
 	void HandleEvent(const sf::Event &);
 
+	// frame time the internal resolution is adjusted to hold, 0 renders at the window size
+	void SetFrameTimeTarget(float ms);
+	const ResolutionGovernor &GetGovernor() const;
+
+	void SetWallMode(WallMode mode);
+	void SetPalettized(bool palettized);
+	void SetFixedPoint(bool fixedPoint);
+	void SetFogDistance(float fogDistance);
+
 private:
 	Game(const Game &);
 
 private:
 	bool					m_Paused;
 
+	// made before the map, which decodes its chunks on it as it loads
+	ThreadPool				m_ThreadPool;
+
 	Player					m_Player;
 
 	Map						m_Map;
@@ -45,10 +52,12 @@ private:
 	int						m_ScreenHeight;
 	bool					m_MouseCaptured;
 
-	sf::Image				m_Buffer;
+	Renderer				m_Renderer;
+	ResolutionGovernor		m_Governor;
 	sf::Texture				m_ScreenTexture;
-	float					*m_DepthBuffer;
 
+	// what the ray through the centre of the view hit, the cell is -1 for nothing
+	int						m_HitCell;
 	sf::Vector2f			m_HitCoords;
 	WallSide				m_HitSide;
 
@@ -0,0 +1,361 @@
+#include "GoldenTest.hpp"
+#include "Renderer.hpp"
+#include "BatchRenderer.hpp"
+#include "Camera.hpp"
+#include "Map.hpp"
+#include "ThreadPool.hpp"
+#include "RayCaster.hpp"
+#include "ResourceLoader.hpp"
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#define GOLDEN_WIDTH 320
+#define GOLDEN_HEIGHT 240
+#define GOLDEN_FRAMES 50
+#define FOV 65
+
+#define GOLDEN_FLOOR 42
+#define GOLDEN_CEILING 1
+
+#define INCREMENTAL_FRAMES 40
+
+#define PI 3.14159265359f
+
+struct GoldenPose {
+	sf::Vector2f	position;
+	sf::Vector2f	look;
+	float			height;
+};
+
+static const GoldenPose Poses[] = {
+	{ sf::Vector2f(14.5f, 8.5f), sf::Vector2f(0.f, -1.f), 0.5f },		// spawn, facing the door to the north
+	{ sf::Vector2f(5.5f, 5.5f), sf::Vector2f(1.f, 0.f), 0.5f },			// down the long east wall
+	{ sf::Vector2f(16.2f, 13.5f), sf::Vector2f(1.f, 0.1f), 0.5f },		// close up on the east door
+	{ sf::Vector2f(24.5f, 15.5f), sf::Vector2f(-1.f, -0.6f), 0.5f },	// diagonal out of the east room
+	{ sf::Vector2f(2.3f, 17.7f), sf::Vector2f(0.7f, -0.7f), 0.35f },	// crouched in a corner
+	{ sf::Vector2f(14.5f, 2.5f), sf::Vector2f(0.3f, 1.f), 0.5f },		// inside the north room, facing its door
+};
+
+// the maps, one with its walls, floor and ceiling from a sheet of 48 texel tiles so the generic
+// kernels and the flats that are not powers of two are covered, and one seen through a fog short
+// enough that most rays stop in it. fog 0 is the run's
+struct GoldenMap {
+	const char		*name;
+	const char		*file;
+	const char		*texture;
+	int				tileSize;
+	float			fog;
+};
+
+static const GoldenMap Maps[] = {
+	{ "E1M1", "Maps/E1M1.rcm", nullptr, 0, 0.f },
+	{ "E1M1_48", "Maps/E1M1.rcm", "Images/walls48.png", 48, 0.f },
+	{ "E1M1", "Maps/E1M1.rcm", nullptr, 0, 4.f },
+};
+
+// still sprites dropped into every map, so the sprite pass is covered too
+struct GoldenSprite {
+	const char		*sheet;
+	sf::Vector2u	frameSize;
+	sf::Vector2f	position;
+	float			scale;
+	float			floatheight;
+};
+
+static const GoldenSprite Sprites[] = {
+	{ "Images/barrel.png", sf::Vector2u(23, 32), sf::Vector2f(14.5f, 6.5f), 0.4f, 0.f },
+	{ "Images/barrel.png", sf::Vector2u(23, 32), sf::Vector2f(9.5f, 5.5f), 0.4f, 0.f },
+	{ "Images/Monsters/imp.png", sf::Vector2u(41, 57), sf::Vector2f(13.8f, 7.2f), 0.65f, 0.f },
+	{ "Images/Monsters/cacodemon.png", sf::Vector2u(76, 78), sf::Vector2f(20.5f, 13.5f), 0.8f, 0.5f },
+};
+
+bool GoldenTest::Run(bool record, int threads, WallMode mode, bool palettized, bool fixedPoint, int batch, float fog) {
+	ThreadPool pool(threads);
+	bool ok = true;
+
+	std::cout << "rendering on " << pool.GetThreadCount() << " thread(s), " << RayCaster::GetPacketWidth() << " ray(s) per packet, "
+		<< (mode == WallMode::SEGMENTS ? "wall segments" : "DDA walls") << (palettized ? ", palettized" : "") << (fixedPoint ? ", fixed point" : "") << ", fog at " << fog << std::endl;
+
+	if (batch > 0) {
+		if (record)
+			std::cout << "batches are only checked, record without --batch" << std::endl;
+
+		for (const GoldenMap &golden : Maps)
+			ok = RunBatch(golden, &pool, mode, palettized, fixedPoint, batch, fog) && ok;
+	} else {
+		for (const GoldenMap &golden : Maps)
+			ok = RunMap(golden, record, &pool, mode, palettized, fixedPoint, fog) && ok;
+
+		ok = RunIncremental(Maps[0], &pool, mode, palettized, fixedPoint, fog) && ok;
+
+	}
+
+	std::cout << (ok ? "golden frames passed" : "golden frames FAILED") << std::endl;
+	return ok;
+}
+
+// the map with the golden textures, floor, ceiling and sprites
+static void SetUpMap(Map &map, const GoldenMap &golden) {
+	if (golden.texture)
+		map.SetTexture(golden.texture, golden.tileSize, golden.tileSize);
+
+	// textured floor and ceiling, as in the game
+	map.SetFloorTexture(GOLDEN_FLOOR);
+	map.SetCeilingTexture(GOLDEN_CEILING);
+
+	for (const GoldenSprite &s : Sprites)
+		map.AddSprite(new Sprite(ResourceLoader::GetSpriteSheet(s.sheet, s.frameSize), s.position, s.scale, s.floatheight));
+}
+
+static Camera GetCamera(int pose) {
+	const GoldenPose &p = Poses[pose];
+	return Camera(p.position, p.look, FOV*PI/180.f, p.height);
+}
+
+bool GoldenTest::RunMap(const GoldenMap &golden, bool record, ThreadPool *pool, WallMode mode, bool palettized, bool fixedPoint, float fog) {
+	Map map(golden.file, nullptr, pool);
+	std::string name = golden.name;
+	fog = golden.fog > 0.f ? golden.fog : fog;
+	Renderer renderer(GOLDEN_WIDTH, GOLDEN_HEIGHT);
+	renderer.SetThreadPool(pool);
+
+	renderer.SetWallMode(mode);
+	renderer.SetPalettized(palettized);
+	renderer.SetFixedPoint(fixedPoint);
+	renderer.SetFogDistance(fog);
+
+	// every timed frame is drawn in full
+	renderer.SetIncremental(false);
+
+	SetUpMap(map, golden);
+
+	bool ok = true;
+	int npose = sizeof(Poses)/sizeof(Poses[0]);
+
+	for (int i=0; i<npose; ++i) {
+		Camera cam = GetCamera(i);
+
+		// time a run of frames, the last one is the one we check
+		map.SortSprites(cam.position);
+
+		sf::Clock clock;
+		for (int f=0; f<GOLDEN_FRAMES; ++f) {
+			renderer.Render(map, cam);
+			renderer.DrawSprites(map.GetSprites(), cam);
+		}
+		float ms = clock.getElapsedTime().asMicroseconds()/(1000.f*GOLDEN_FRAMES);
+
+		std::cout << name << " pose " << i << ": " << ms << " ms/frame, " << renderer.GetCulledSprites() << " sprite(s) culled";
+
+		if (mode == WallMode::SEGMENTS) {
+			const SegmentCaster &segments = renderer.GetSegmentCaster();
+			std::cout << ", " << segments.GetFaceCount() << " face(s), " << segments.GetFallbackCount() << " column(s) traced";
+		}
+
+		ok = CheckFrame(renderer.GetFrameBuffer(), GetFileName(name, i, palettized, fixedPoint, fog), record) && ok;
+	}
+
+	return ok;
+}
+
+bool GoldenTest::RunBatch(const GoldenMap &golden, ThreadPool *pool, WallMode mode, bool palettized, bool fixedPoint, int batch, float fog) {
+	Map map(golden.file, nullptr, pool);
+	std::string name = golden.name;
+	fog = golden.fog > 0.f ? golden.fog : fog;
+	BatchRenderer renderer(batch, GOLDEN_WIDTH, GOLDEN_HEIGHT);
+	renderer.SetThreadPool(pool);
+
+	for (int i=0; i<batch; ++i) {
+		renderer.GetRenderer(i).SetWallMode(mode);
+		renderer.GetRenderer(i).SetPalettized(palettized);
+		renderer.GetRenderer(i).SetFixedPoint(fixedPoint);
+		renderer.GetRenderer(i).SetFogDistance(fog);
+		renderer.GetRenderer(i).SetIncremental(false);
+	}
+
+	SetUpMap(map, golden);
+
+	// the poses over and over, one per view
+	int npose = sizeof(Poses)/sizeof(Poses[0]);
+	std::vector<Camera> cams;
+
+	for (int i=0; i<batch; ++i)
+		cams.push_back(GetCamera(i%npose));
+
+	float ms = 0.f;
+	for (int f=0; f<GOLDEN_FRAMES; ++f) {
+		renderer.Render(map, cams);
+		ms += renderer.GetBatchMs();
+	}
+
+	std::cout << name << " batch of " << batch << " view(s): " << ms/GOLDEN_FRAMES << " ms/batch, "
+		<< batch*GOLDEN_FRAMES*1000.f/ms << " frames/s across the batch" << std::endl;
+
+	bool ok = true;
+	for (int i=0; i<batch; ++i) {
+		std::cout << name << " view " << i << " (pose " << i%npose << ")";
+		ok = CheckFrame(renderer.GetFrameBuffer(i), GetFileName(name, i%npose, palettized, fixedPoint, fog), false) && ok;
+	}
+
+	return ok;
+}
+
+bool GoldenTest::RunIncremental(const GoldenMap &golden, ThreadPool *pool, WallMode mode, bool palettized, bool fixedPoint, float fog) {
+	Map map(golden.file, nullptr, pool);
+	std::string name = golden.name;
+	fog = golden.fog > 0.f ? golden.fog : fog;
+	Renderer incremental(GOLDEN_WIDTH, GOLDEN_HEIGHT);
+	Renderer full(GOLDEN_WIDTH, GOLDEN_HEIGHT);
+
+	for (Renderer *renderer : { &incremental, &full }) {
+		renderer->SetThreadPool(pool);
+		renderer->SetWallMode(mode);
+		renderer->SetPalettized(palettized);
+		renderer->SetFixedPoint(fixedPoint);
+		renderer->SetFogDistance(fog);
+	}
+
+	full.SetIncremental(false);
+
+	SetUpMap(map, golden);
+	Sprite *barrel = map.GetSprites()[0];
+
+	// spawn, facing the door to the north, walls are set just right of it
+	Camera cam = GetCamera(0);
+	int door = 5*map.GetWidth() + 14;
+	int cell = 6*map.GetWidth() + 15;
+	int back = 4*map.GetWidth() + 16;
+
+	Wall wall = map.Get(0);
+	Wall empty = map.Get(cell);
+
+	int bad = 0;
+	long redrawn = 0;
+
+	for (int f=0; f<INCREMENTAL_FRAMES; ++f) {
+		if (f == 2)
+			map.OpenDoor(door);
+
+		if (f == 12)
+			map.Set(cell, wall);
+
+		if (f == 20) {
+			// the same cell with other faces, and one out of sight behind the room's wall
+			Wall retextured = wall;
+			retextured.north = retextured.east = retextured.south = retextured.west = 7;
+			map.Set(cell, retextured);
+			map.Set(back, retextured);
+		}
+
+		if (f == 28)
+			map.Set(cell, empty);
+
+		// one frame from elsewhere, the next one back is drawn in full again
+		if (f == 34)
+			cam.position.x += 0.25f;
+		if (f == 35)
+			cam = GetCamera(0);
+
+		barrel->SetPosition(sf::Vector2f(12.5f + f*0.1f, 7.5f));
+
+		map.Tick(0.05f);
+		map.SortSprites(cam.position);
+
+		incremental.Render(map, cam);
+		incremental.DrawSprites(map.GetSprites(), cam);
+		full.Render(map, cam);
+		full.DrawSprites(map.GetSprites(), cam);
+
+		redrawn += incremental.GetRedrawnColumns();
+
+		if (std::memcmp(incremental.GetFrameBuffer().GetPixels(), full.GetFrameBuffer().GetPixels(), GOLDEN_WIDTH*GOLDEN_HEIGHT*4) != 0
+			|| std::memcmp(incremental.GetFrameBuffer().GetDepthBuffer(), full.GetFrameBuffer().GetDepthBuffer(), GOLDEN_WIDTH*sizeof(float)) != 0) {
+			if (bad == 0)
+				std::cout << name << " incremental frame " << f << " differs from the full frame" << std::endl;
+			bad++;
+		}
+	}
+
+	std::cout << name << " incremental: " << INCREMENTAL_FRAMES << " frames, " << redrawn/INCREMENTAL_FRAMES << " of " << GOLDEN_WIDTH << " columns redrawn on average";
+
+	// drawing every column would pass without checking anything
+	if (redrawn >= (long)INCREMENTAL_FRAMES*GOLDEN_WIDTH) {
+		std::cout << ", never drawn incrementally" << std::endl;
+		return false;
+	}
+
+	if (bad > 0) {
+		std::cout << ", " << bad << " frame(s) differ" << std::endl;
+		return false;
+	}
+
+	std::cout << ", ok" << std::endl;
+	return true;
+}
+
+std::string GoldenTest::GetFileName(const std::string &name, int pose, bool palettized, bool fixedPoint, float fog) {
+	std::ostringstream filename;
+	filename << "Golden/" << name << "_" << pose;
+
+	if (fog != FOG_DISTANCE)
+		filename << "_fog" << fog;
+
+	filename << (fixedPoint ? "_fixed" : "") << (palettized ? "_8bit" : "") << ".png";
+
+	return filename.str();
+}
+
+bool GoldenTest::CheckFrame(const FrameBuffer &buffer, const std::string &filename, bool record) {
+	sf::Image frame;
+	buffer.CopyToImage(frame);
+
+	if (record) {
+		if (!frame.saveToFile(filename)) {
+			std::cout << ", could not write " << filename << std::endl;
+			return false;
+		}
+
+		std::cout << ", recorded " << filename << std::endl;
+		return true;
+	}
+
+	sf::Image golden;
+	if (!golden.loadFromFile(filename)) {
+		std::cout << ", missing " << filename << std::endl;
+		return false;
+	}
+
+	if (golden.getSize() != frame.getSize()) {
+		std::cout << ", size mismatch against " << filename << std::endl;
+		return false;
+	}
+
+	// count the differing pixels and the worst channel difference
+	const sf::Uint8 *a = frame.getPixelsPtr();
+	const sf::Uint8 *b = golden.getPixelsPtr();
+	int diffs = 0;
+	int maxdiff = 0;
+
+	for (int p=0; p<GOLDEN_WIDTH*GOLDEN_HEIGHT; ++p) {
+		int d = 0;
+		for (int c=0; c<4; ++c)
+			d = std::max(d, std::abs(a[p*4 + c] - b[p*4 + c]));
+
+		if (d > 0)
+			diffs++;
+		maxdiff = std::max(maxdiff, d);
+	}
+
+	if (diffs > 0) {
+		std::cout << ", " << diffs << " pixels differ (max " << maxdiff << ")" << std::endl;
+		return false;
+	}
+
+	std::cout << ", ok" << std::endl;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include "Renderer.hpp"
+
+class ThreadPool;
+struct GoldenMap;
+
+// renders a fixed set of camera poses headless and compares them against stored golden frames
+class GoldenTest {
+public:
+	// returns true if every frame matched (or was written when recording). the palettized and
+	// fixed point pipelines are checked against golden sets of their own, as is any fog distance
+	// but the default. with batch > 0 the poses are drawn as that many views through a
+	// BatchRenderer instead, each view checked against its pose's frame
+	static bool Run(bool record, int threads, WallMode mode, bool palettized, bool fixedPoint, int batch, float fog);
+
+private:
+	static bool RunMap(const GoldenMap &golden, bool record, ThreadPool *pool, WallMode mode, bool palettized, bool fixedPoint, float fog);
+	static bool RunBatch(const GoldenMap &golden, ThreadPool *pool, WallMode mode, bool palettized, bool fixedPoint, int batch, float fog);
+
+	// a scripted run under a still camera (a door opening, walls set, a sprite moving) drawn
+	// incrementally and in full, every frame compared between the two
+	static bool RunIncremental(const GoldenMap &golden, ThreadPool *pool, WallMode mode, bool palettized, bool fixedPoint, float fog);
+
+	// compare a frame against a golden file, or write it when recording, and print the outcome
+	static bool CheckFrame(const FrameBuffer &frame, const std::string &filename, bool record);
+	static std::string GetFileName(const std::string &name, int pose, bool palettized, bool fixedPoint, float fog);
+};
\ No newline at end of file
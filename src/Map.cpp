@@ -2,16 +2,174 @@
 #include "ResourceLoader.hpp"
 #include "SoundEngine.hpp"
 #include "Player.hpp"
+#include "CellCodec.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 
-Map::Map(const std::string &filename, Player *player)
-	: m_Array(nullptr), m_Width(0), m_Height(0), m_RegionName("E1"), m_MapName("M1"), m_CeilingColor(sf::Color(56, 56, 56)),
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#define CHANGE_LOG_SIZE 1024
+
+// version 1 files have no header to speak of, the cells start at a fixed offset
+#define MAP_V1_CELLS 72
+
+// the version 2 header, little-endian as the cells are. names are zero padded and need no
+// terminator, offsets count from the start of the file
+struct MapHeader {
+	char		magic[4];
+	sf::Uint32	version;
+	sf::Uint32	headerSize;
+	sf::Uint32	width;
+	sf::Uint32	height;
+	char		region[32];
+	char		map[32];
+	char		texture[32];
+	sf::Uint8	floorColor[4];
+	sf::Uint8	ceilingColor[4];
+	sf::Int32	floorTexture;
+	sf::Int32	ceilingTexture;
+	sf::Uint32	entityCount;
+	sf::Uint64	cellOffset;
+	sf::Uint64	entityOffset;
+
+	// appended later, zero in the shorter headers written before
+	sf::Uint32	cellEncoding;
+	sf::Uint32	chunkCells;
+	sf::Uint32	tileWidth;
+	sf::Uint32	tileHeight;
+
+	// the planes and distance field as the map keeps them (PlaneLayout), only written with raw
+	// cells, 0 for none. with them the counts loading would otherwise take from the cells
+	sf::Uint64	planeOffset;
+	sf::Uint32	doorCount;
+	sf::Uint32	maxDistance;
+
+	// the visible sets as VisibleSet::Write lays them out, 0 for none
+	sf::Uint64	visibleOffset;
+	sf::Uint64	visibleSize;
+};
+
+// how the cells are stored. chunked cells start with an index of MapChunk, one per chunkCells
+// cells (the last chunk has what is left), each coded by CellCodec on its own
+enum class MapEncoding : sf::Uint32 {
+	RAW,
+	CHUNKED
+};
+
+struct MapChunk {
+	sf::Uint64	offset;
+	sf::Uint32	size;
+	sf::Uint32	reserved;
+};
+
+struct MapEntity {
+	sf::Uint32	id;
+	float		position[2];
+	float		direction[2];
+};
+
+static_assert(sizeof(MapHeader) == 200 && sizeof(MapEntity) == 20 && sizeof(MapChunk) == 16, "map file structures are padded");
+
+// where each plane lies from the start of the block, all on a MAP_CELL_ALIGN boundary
+struct PlaneLayout {
+	size_t	solid;
+	size_t	flags;
+	size_t	faces[4];
+	size_t	field;
+	size_t	size;
+};
+
+static size_t AlignCells(size_t offset) {
+	return (offset + MAP_CELL_ALIGN - 1)/MAP_CELL_ALIGN*MAP_CELL_ALIGN;
+}
+
+static int GetSolidStride(int width) {
+	return (width + 2 + 63)/64;
+}
+
+static PlaneLayout GetPlaneLayout(int width, int height) {
+	size_t cells = (size_t)width*height;
+
+	PlaneLayout layout;
+	layout.solid = 0;
+	layout.flags = AlignCells((size_t)GetSolidStride(width)*(height + 2)*sizeof(sf::Uint64));
+	layout.faces[0] = AlignCells(layout.flags + cells);
+	for (int i=1; i<4; ++i)
+		layout.faces[i] = AlignCells(layout.faces[i - 1] + cells);
+	layout.field = AlignCells(layout.faces[3] + cells);
+	layout.size = AlignCells(layout.field + (size_t)(width + 2)*(height + 2) + DISTANCE_FIELD_PAD);
+
+	return layout;
+}
+
+// what the rays take for granted in planes read from a file: the bitmap solid and the distance
+// field 0 all round the map, so a ray stops on the border however wrong the cells inside are
+static bool HasBorders(const char *planes, int width, int height) {
+	PlaneLayout layout = GetPlaneLayout(width, height);
+	const sf::Uint64 *solid = (const sf::Uint64 *)(planes + layout.solid);
+	const sf::Uint8 *field = (const sf::Uint8 *)(planes + layout.field);
+	int solidStride = GetSolidStride(width);
+	int fieldStride = width + 2;
+
+	auto isSolid = [&](int x, int y) {
+		int bit = x + 1;
+		return ((solid[(y + 1)*solidStride + (bit >> 6)] >> (bit & 63)) & 1) != 0;
+	};
+
+	for (int x=-1; x<=width; ++x) {
+		if (!isSolid(x, -1) || !isSolid(x, height) || field[x + 1] != 0 || field[(size_t)(height + 1)*fieldStride + x + 1] != 0)
+			return false;
+	}
+
+	for (int y=0; y<height; ++y) {
+		if (!isSolid(-1, y) || !isSolid(width, y) || field[(size_t)(y + 1)*fieldStride] != 0 || field[(size_t)(y + 1)*fieldStride + width + 1] != 0)
+			return false;
+	}
+
+	return true;
+}
+
+static std::string ReadName(const char *name, size_t size) {
+	return std::string(name, std::find(name, name + size, '\0'));
+}
+
+static sf::Color ReadColor(const sf::Uint8 *rgb) {
+	return sf::Color(rgb[0], rgb[1], rgb[2]);
+}
+
+static void CopyColor(sf::Uint8 *rgb, const sf::Color &color) {
+	rgb[0] = color.r;
+	rgb[1] = color.g;
+	rgb[2] = color.b;
+}
+
+// if a sheet holds at least one tile of that size
+static bool FitsTile(const sf::Image &sheet, sf::Uint32 tileWidth, sf::Uint32 tileHeight) {
+	return tileWidth > 0 && tileHeight > 0 && tileWidth <= sheet.getSize().x && tileHeight <= sheet.getSize().y;
+}
+
+template<size_t N>
+static void CopyName(char (&name)[N], const std::string &value) {
+	std::memcpy(name, value.c_str(), std::min(N, value.size()));
+}
+
+Map::Map(const std::string &filename, Player *player, ThreadPool *pool)
+	: m_Array(nullptr), m_ThreadPool(pool), m_Width(0), m_Height(0), m_RegionName("E1"), m_MapName("M1"), m_CeilingColor(sf::Color(56, 56, 56)),
 	m_FloorColor(sf::Color(112, 112, 112)), m_Texture("Images/walls.png"),
-	m_Player(player)
+	m_DoorCount(0), m_Planes(nullptr), m_Solid(nullptr), m_SolidStride(0), m_Flags(nullptr), m_Faces(), m_DistanceField(nullptr), m_FieldStride(0), m_MaxDistance(0),
+	m_DoorState(nullptr), m_DoorAmount(nullptr), m_FloorTexture(0), m_CeilingTexture(0), m_Player(player), m_Revision(0), m_LogStart(0)
 {
 	Load(filename);
 }
@@ -22,21 +180,25 @@ Map::~Map() {
 		delete sprite;
 	}
 
-	// delete map
-	delete[] m_Array;
+	// the cells go with the file
 }
 
 void Map::Tick(float dt) {
-	// door sliding
-	for (auto itr = m_MovingDoors.begin(); itr != m_MovingDoors.end();) {
-		itr->second += dt;
-
-		if (itr->second >= 1.f) {
-			m_OpenDoors.insert(itr->first);
-			itr = m_MovingDoors.erase(itr);
+	// door sliding, doors that finish drop out of the list
+	size_t moving = 0;
+	for (int p : m_MovingDoors) {
+		m_DoorAmount[p] += dt;
+		MarkChanged(p);
+
+		if (m_DoorAmount[p] >= 1.f) {
+			m_DoorState[p] = (sf::Uint8)((m_DoorState[p] & ~(int)DoorState::MOVING) | (int)DoorState::OPEN);
 		} else
-			++itr;
+			m_MovingDoors[moving++] = p;
 	}
+	m_MovingDoors.resize(moving);
+
+	// catch up on the visible sets Set left stale, a budget's worth a tick
+	m_VisibleSet.Refresh();
 
 	// sprite tick
 	for (auto sprite : m_Sprites) {
@@ -61,17 +223,42 @@ Wall Map::Get(int p) const {
 }
 
 void Map::Set(int x, int y, Wall value) {
-	if (m_Array)
-		m_Array[m_Width*y + x] = value.value;
+	Set(m_Width*y + x, value);
 }
 
 void Map::Set(int p, Wall value) {
-	if (m_Array)
+	if (m_Array) {
+		bool wall = IsWall(p);
+		bool blocks = BlocksSight(p);
+
+		m_DoorCount -= IsDoor(p);
 		m_Array[p] = value.value;
+		UpdatePlanes(p);
+		m_DoorCount += IsDoor(p);
+
+		// only cells within the largest distance of p can have had it (or now have it) nearest
+		if (wall != IsWall(p)) {
+			int x = p%m_Width;
+			int y = p/m_Width;
+			int r = m_MaxDistance + 1;
+
+			UpdateDistanceField(std::max(0, x - r), std::max(0, y - r), std::min(m_Width, x + r + 1), std::min(m_Height, y + r + 1));
+		}
+
+		if (blocks != BlocksSight(p))
+			m_VisibleSet.Invalidate(*this, p);
+
+		MarkChanged(p);
+	}
+}
+
+bool Map::IsInside(int x, int y) const {
+	return x >= 0 && x < m_Width && y >= 0 && y < m_Height;
 }
 
 bool Map::IsWall(int x, int y) const {
-	return Get(x, y).value != 0;
+	int bit = x + 1;
+	return (m_Solid[(y + 1)*m_SolidStride + (bit >> 6)] >> (bit & 63)) & 1;
 }
 
 bool Map::IsWall(int p) const {
@@ -79,15 +266,31 @@ bool Map::IsWall(int p) const {
 }
 
 bool Map::IsDoor(int x, int y) const {
-	return (Get(x, y).flags & (int)WallFlags::DOOR) == (int)WallFlags::DOOR;
+	return IsDoor(y*m_Width + x);
 }
 
 bool Map::IsDoor(int p) const {
-	return (Get(p).flags & (int)WallFlags::DOOR) == (int)WallFlags::DOOR;
+	return (m_Flags[p] & (int)WallFlags::DOOR) == (int)WallFlags::DOOR;
+}
+
+bool Map::BlocksSight(int p) const {
+	return IsWall(p) && !IsDoor(p);
+}
+
+int Map::GetFaceTexture(int p, int side) const {
+	return m_Faces[side][p];
 }
 
 void Map::OpenDoor(int x, int y) {
-	m_MovingDoors[y*m_Width + x] = 0.f;
+	int p = y*m_Width + x;
+
+	// a door already moving starts over
+	if (!IsMoving(p))
+		m_MovingDoors.push_back(p);
+
+	m_DoorState[p] |= (int)DoorState::MOVING;
+	m_DoorAmount[p] = 0.f;
+	MarkChanged(p);
 	SoundEngine::PlaySound("Sounds/door.wav", sf::Vector2f(x + 0.5f, y+0.5f), 100.f, 1.f);
 }
 
@@ -102,7 +305,7 @@ bool Map::IsOpen(int x, int y) const {
 }
 
 bool Map::IsOpen(int p) const {
-	return m_OpenDoors.count(p) > 0;
+	return (m_DoorState[p] & (int)DoorState::OPEN) != 0;
 }
 
 bool Map::IsMoving(int x, int y) const {
@@ -110,7 +313,7 @@ bool Map::IsMoving(int x, int y) const {
 }
 
 bool Map::IsMoving(int p) const {
-	return m_MovingDoors.count(p) > 0;
+	return (m_DoorState[p] & (int)DoorState::MOVING) != 0;
 }
 
 bool Map::IsMoving(int x, int y, float &amount) const {
@@ -118,8 +321,8 @@ bool Map::IsMoving(int x, int y, float &amount) const {
 }
 
 bool Map::IsMoving(int p, float &amount) const {
-	if (m_MovingDoors.count(p) > 0) {
-		amount = m_MovingDoors.at(p);
+	if (IsMoving(p)) {
+		amount = m_DoorAmount[p];
 		return true;
 	}
 
@@ -127,17 +330,14 @@ bool Map::IsMoving(int p, float &amount) const {
 }
 
 bool Map::GetCollide(int x, int y) const {
-	if (IsDoor(x, y) && IsOpen(x, y))
-		return false;
-
-	return (Get(x, y).flags & (int)WallFlags::COLLIDE) == (int)WallFlags::COLLIDE;
+	return GetCollide(y*m_Width + x);
 }
 
 bool Map::GetCollide(int p) const {
 	if (IsDoor(p) && IsOpen(p))
 		return false;
 
-	return (Get(p).flags & (int)WallFlags::COLLIDE) == (int)WallFlags::COLLIDE;
+	return (m_Flags[p] & (int)WallFlags::COLLIDE) == (int)WallFlags::COLLIDE;
 }
 
 void Map::SetCollide(int x, int y) {
@@ -158,12 +358,143 @@ int Map::GetHeight() const {
 	return m_Height;
 }
 
+const int *Map::GetData() const {
+	return m_Array;
+}
+
 int Map::GetTexWidth() const {
-	return m_TexWidth;
+	return m_WallAtlas.GetTexWidth();
 }
 
 int Map::GetTexHeight() const {
-	return m_TexHeight;
+	return m_WallAtlas.GetTexHeight();
+}
+
+bool Map::HasDoors() const {
+	return m_DoorCount > 0;
+}
+
+const sf::Uint8 *Map::GetDistanceField() const {
+	return m_DistanceField + m_FieldStride + 1;
+}
+
+int Map::GetFieldStride() const {
+	return m_FieldStride;
+}
+
+int Map::GetBorderDistance(int x, int y) const {
+	return std::min(std::min(x + 1, m_Width - x), std::min(y + 1, m_Height - y));
+}
+
+const VisibleSet &Map::GetVisibleSet() const {
+	return m_VisibleSet;
+}
+
+bool Map::CanSee(int from, int to) const {
+	return m_VisibleSet.CanSee(from, to);
+}
+
+void Map::UpdateDistanceField(int x0, int y0, int x1, int y1) {
+	// the border stays 0, anything outside the window keeps its distance
+	sf::Uint8 *field = m_DistanceField + m_FieldStride + 1;
+	int s = m_FieldStride;
+
+	// chessboard distance in two passes, down and right then up and left. a row takes the
+	// row before it all at once, then runs along itself
+	for (int y = y0; y < y1; y++) {
+		sf::Uint8 *f = field + y*s;
+		const sf::Uint8 *above = f - s;
+		const int *cells = m_Array + y*m_Width;
+
+		for (int x = x0; x < x1; x++) {
+			int d = std::min(std::min(above[x - 1], above[x]), above[x + 1]) + 1;
+			f[x] = cells[x] ? 0 : (sf::Uint8)std::min(255, d);
+		}
+
+		for (int x = x0; x < x1; x++)
+			f[x] = (sf::Uint8)std::min((int)f[x], f[x - 1] + 1);
+	}
+
+	for (int y = y1 - 1; y >= y0; y--) {
+		sf::Uint8 *f = field + y*s;
+		const sf::Uint8 *below = f + s;
+
+		for (int x = x0; x < x1; x++) {
+			int d = std::min(std::min(below[x - 1], below[x]), below[x + 1]) + 1;
+			f[x] = (sf::Uint8)std::min((int)f[x], d);
+		}
+
+		for (int x = x1 - 1; x >= x0; x--) {
+			f[x] = (sf::Uint8)std::min((int)f[x], f[x + 1] + 1);
+			m_MaxDistance = std::max(m_MaxDistance, (int)f[x]);
+		}
+	}
+}
+
+void Map::UsePlanes(char *planes) {
+	PlaneLayout layout = GetPlaneLayout(m_Width, m_Height);
+
+	m_Planes = planes;
+	m_Solid = (sf::Uint64 *)(planes + layout.solid);
+	m_SolidStride = GetSolidStride(m_Width);
+	m_Flags = (sf::Uint8 *)(planes + layout.flags);
+	for (int i=0; i<4; ++i)
+		m_Faces[i] = (sf::Uint8 *)(planes + layout.faces[i]);
+
+	m_DistanceField = (sf::Uint8 *)(planes + layout.field);
+	m_FieldStride = m_Width + 2;
+}
+
+void Map::BuildPlanes() {
+	PlaneLayout layout = GetPlaneLayout(m_Width, m_Height);
+	m_PlaneStore.assign((layout.size + 7)/8, 0);
+	UsePlanes((char *)m_PlaneStore.data());
+
+	// the bitmap's border is solid, the field's stays 0
+	for (int x=-1; x<=m_Width; ++x) {
+		SetSolid(x, -1, true);
+		SetSolid(x, m_Height, true);
+	}
+
+	m_DoorCount = 0;
+	for (int y=0; y<m_Height; ++y) {
+		SetSolid(-1, y, true);
+		SetSolid(m_Width, y, true);
+
+		for (int x=0; x<m_Width; ++x) {
+			UpdatePlanes(x, y);
+			m_DoorCount += IsDoor(y*m_Width + x);
+		}
+	}
+
+	m_MaxDistance = 0;
+	UpdateDistanceField(0, 0, m_Width, m_Height);
+}
+
+void Map::UpdatePlanes(int p) {
+	UpdatePlanes(p%m_Width, p/m_Width);
+}
+
+void Map::UpdatePlanes(int x, int y) {
+	int p = y*m_Width + x;
+	Wall wall = m_Array[p];
+
+	SetSolid(x, y, wall.value != 0);
+	m_Flags[p] = (sf::Uint8)wall.flags;
+	m_Faces[0][p] = (sf::Uint8)wall.north;
+	m_Faces[1][p] = (sf::Uint8)wall.east;
+	m_Faces[2][p] = (sf::Uint8)wall.south;
+	m_Faces[3][p] = (sf::Uint8)wall.west;
+}
+
+void Map::SetSolid(int x, int y, bool solid) {
+	int bit = x + 1;
+	sf::Uint64 &word = m_Solid[(y + 1)*m_SolidStride + (bit >> 6)];
+
+	if (solid)
+		word |= (sf::Uint64)1 << (bit & 63);
+	else
+		word &= ~((sf::Uint64)1 << (bit & 63));
 }
 
 const sf::Color &Map::GetFloorColor() const {
@@ -174,10 +505,78 @@ const sf::Color &Map::GetCeilingColor() const {
 	return m_CeilingColor;
 }
 
+int Map::GetFloorTexture() const {
+	return m_FloorTexture;
+}
+
+int Map::GetCeilingTexture() const {
+	return m_CeilingTexture;
+}
+
+void Map::SetFloorTexture(int tex) {
+	m_FloorTexture = tex;
+
+	// every view changes
+	m_Changes.clear();
+	m_LogStart = ++m_Revision;
+}
+
+void Map::SetCeilingTexture(int tex) {
+	m_CeilingTexture = tex;
+
+	m_Changes.clear();
+	m_LogStart = ++m_Revision;
+}
+
+void Map::SetTexture(const std::string &texture, int tileWidth, int tileHeight) {
+	sf::Image *t = ResourceLoader::GetImage(texture);
+	if (tileWidth < 1 || tileHeight < 1 || !FitsTile(*t, (sf::Uint32)tileWidth, (sf::Uint32)tileHeight))
+		throw std::runtime_error("Texture does not hold a tile");
+
+	m_Texture = texture;
+	m_WallAtlas.Create(*t, tileWidth, tileHeight);
+
+	m_Changes.clear();
+	m_LogStart = ++m_Revision;
+}
+
 sf::Image *Map::GetWallImage() const {
 	return ResourceLoader::GetImage(m_Texture);
 }
 
+const WallAtlas &Map::GetWallAtlas() const {
+	return m_WallAtlas;
+}
+
+unsigned int Map::GetRevision() const {
+	return m_Revision;
+}
+
+bool Map::GetChangedCells(unsigned int since, std::vector<int> &cells) const {
+	if (since < m_LogStart)
+		return false;
+
+	// the log is in revision order, walk back to the first change after since
+	auto itr = m_Changes.end();
+	while (itr != m_Changes.begin() && std::prev(itr)->first > since)
+		--itr;
+
+	for (; itr != m_Changes.end(); ++itr)
+		cells.push_back(itr->second);
+
+	return true;
+}
+
+void Map::MarkChanged(int p) {
+	m_Changes.push_back(std::make_pair(++m_Revision, p));
+
+	// forget the oldest change, anything older than it has to be treated as a full change
+	if (m_Changes.size() > CHANGE_LOG_SIZE) {
+		m_LogStart = m_Changes.front().first;
+		m_Changes.pop_front();
+	}
+}
+
 void Map::AddSprite(Sprite *spr) {
 	m_Sprites.push_back(spr);
 }
@@ -187,7 +586,11 @@ const std::vector<Sprite *> &Map::GetSprites() const {
 }
 
 void Map::SortSprites(const sf::Vector2f &pos) {
-	std::sort(m_Sprites.begin(), m_Sprites.end(), [&pos](const Sprite *a, const Sprite *b) -> bool {
+	SortSprites(m_Sprites, pos);
+}
+
+void Map::SortSprites(std::vector<Sprite *> &sprites, const sf::Vector2f &pos) {
+	std::sort(sprites.begin(), sprites.end(), [&pos](const Sprite *a, const Sprite *b) -> bool {
 		const sf::Vector2f &apos = a->GetPosition();
 		const sf::Vector2f &bpos = b->GetPosition();
 
@@ -198,121 +601,354 @@ void Map::SortSprites(const sf::Vector2f &pos) {
 	});
 }
 
+// put a written file in place of the old one, std::rename will not replace a file on Windows
+static bool MoveOver(const std::string &from, const std::string &to) {
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
 void Map::Save() {
 	Save(m_FileName);
 }
 
-void Map::Save(const std::string &filename) {
-	// open the file
-	std::ofstream file(filename);
-
-	// write the magic number
-	char magic[] = "RCM";
-	file.write(magic, 4);
-
-	// write the region name and map name
-	file.write(m_RegionName.c_str(), 20).write(m_MapName.c_str(), 20);
-
-	// write the map width and height
-	file.put((char)m_Width).put((char)m_Height);
-
-	// write the floor and ceiling color
-	file.write((char *)(&m_FloorColor), 3).write((char *)(&m_CeilingColor), 3);
+void Map::Save(const std::string &filename, bool compressed) {
+	int cells = m_Width*m_Height;
+	int chunks = compressed ? (cells + MAP_CHUNK_CELLS - 1)/MAP_CHUNK_CELLS : 0;
+
+	MapHeader header;
+	std::memset(&header, 0, sizeof(header));
+
+	std::memcpy(header.magic, MAP_MAGIC, 4);
+	header.version = MAP_VERSION;
+	header.headerSize = sizeof(header);
+	header.width = m_Width;
+	header.height = m_Height;
+	CopyName(header.region, m_RegionName);
+	CopyName(header.map, m_MapName);
+	CopyName(header.texture, m_Texture);
+	CopyColor(header.floorColor, m_FloorColor);
+	CopyColor(header.ceilingColor, m_CeilingColor);
+	header.floorTexture = m_FloorTexture;
+	header.ceilingTexture = m_CeilingTexture;
+	header.entityCount = (sf::Uint32)m_Sprites.size();
+	header.cellOffset = (sizeof(header) + MAP_CELL_ALIGN - 1)/MAP_CELL_ALIGN*MAP_CELL_ALIGN;
+	header.entityOffset = header.cellOffset + (sf::Uint64)cells*4;
+	header.cellEncoding = (sf::Uint32)(compressed ? MapEncoding::CHUNKED : MapEncoding::RAW);
+	header.chunkCells = compressed ? MAP_CHUNK_CELLS : 0;
+	header.tileWidth = m_WallAtlas.GetTexWidth();
+	header.tileHeight = m_WallAtlas.GetTexHeight();
+
+	// raw cells take the planes with them, so loading uses those in place too
+	PlaneLayout layout = GetPlaneLayout(m_Width, m_Height);
+	if (!compressed) {
+		header.planeOffset = AlignCells((size_t)header.entityOffset);
+		header.entityOffset = header.planeOffset + layout.size;
+	}
+	header.doorCount = (sf::Uint32)m_DoorCount;
+	header.maxDistance = (sf::Uint32)m_MaxDistance;
+
+	// code the chunks one after the other behind their index
+	std::vector<MapChunk> index(chunks);
+	std::vector<char> coded;
+	for (int c=0; c<chunks; ++c) {
+		size_t begin = coded.size();
+		int first = c*MAP_CHUNK_CELLS;
+		CellCodec::Encode((const sf::Uint32 *)m_Array + first, std::min(MAP_CHUNK_CELLS, cells - first), coded);
+
+		index[c].offset = header.cellOffset + chunks*sizeof(MapChunk) + begin;
+		index[c].size = (sf::Uint32)(coded.size() - begin);
+		index[c].reserved = 0;
+	}
 
-	// write the wall texture (first 20 bytes)
-	file.write(m_Texture.c_str(), 20);
+	if (compressed)
+		header.entityOffset = header.cellOffset + chunks*sizeof(MapChunk) + coded.size();
+
+	// the visible sets go after, worked out if loading left it to here and brought up to date,
+	// so loading can take them as they are
+	if (m_VisibleSet.IsEmpty())
+		m_VisibleSet.Build(*this);
+	while (m_VisibleSet.Refresh());
+
+	std::vector<char> visible;
+	m_VisibleSet.Write(visible);
+	sf::Uint64 cellsEnd = header.entityOffset;
+	header.visibleOffset = AlignCells((size_t)cellsEnd);
+	header.visibleSize = visible.size();
+	header.entityOffset = header.visibleOffset + visible.size();
+
+	// the cells may be the pages of the file being replaced, so write a new one and swap it in
+	std::string temp = filename + ".tmp";
+	std::ofstream file(temp, std::ios::binary);
+
+	// write the header, padded up to the cells
+	file.write((char *)&header, sizeof(header));
+	for (size_t i = sizeof(header); i < header.cellOffset; ++i)
+		file.put(0);
 
 	// write the map data
-	file.write((char *)m_Array, m_Width*m_Height*4);
-	
-	// write the entity count
-	unsigned int ec = m_Sprites.size();
-	file.write((char *)&ec, 4);
+	if (compressed)
+		file.write((char *)index.data(), index.size()*sizeof(MapChunk)).write(coded.data(), coded.size());
+	else {
+		file.write((char *)m_Array, (std::streamsize)cells*4);
+		for (sf::Uint64 i = header.cellOffset + (sf::Uint64)cells*4; i < header.planeOffset; ++i)
+			file.put(0);
+
+		file.write(m_Planes, (std::streamsize)layout.size);
+	}
 
-	// write the entity data
-	for (auto &sprite : m_Sprites) {
-		// write entity id
+	for (sf::Uint64 i = cellsEnd; i < header.visibleOffset; ++i)
 		file.put(0);
+	file.write(visible.data(), visible.size());
 
-		// write entity position
-		file.write((char *)&sprite->GetPosition(), 8);
-
-		// write entity direction
-		file.write((char *)&sprite->GetForward(), 8);
+	// write the entity data
+	for (auto &sprite : m_Sprites) {
+		MapEntity entity;
+		entity.id = 0;
+		entity.position[0] = sprite->GetPosition().x;
+		entity.position[1] = sprite->GetPosition().y;
+		entity.direction[0] = sprite->GetForward().x;
+		entity.direction[1] = sprite->GetForward().y;
+
+		file.write((char *)&entity, sizeof(entity));
 	}
 
 	// close the file
 	file.close();
+
+	if (!file || !MoveOver(temp, filename)) {
+		std::remove(temp.c_str());
+		throw std::runtime_error("File could not be saved");
+	}
 }
 
 void Map::Load(const std::string &filename) {
-	// open the file
-	std::ifstream file(filename);
+	// everything is read into locals and checked first, the map only changes once nothing can fail
+	MappedFile file;
+	if (!file.Open(filename))
+		throw std::runtime_error("File could not be opened");
+
+	char *data = file.GetData();
+	size_t size = file.GetSize();
+
+	sf::Uint64 width, height, cellOffset, entityOffset, planeOffset = 0, visibleOffset = 0, visibleSize = 0;
+	sf::Uint32 entityCount, encoding = (sf::Uint32)MapEncoding::RAW, chunkCells = 0, doorCount = 0, maxDistance = 0;
+	sf::Uint32 tileWidth = MAP_TILE_SIZE, tileHeight = MAP_TILE_SIZE;
+	sf::Color floorColor, ceilingColor;
+	std::string regionName, mapName, texture;
+	int floorTexture = m_FloorTexture, ceilingTexture = m_CeilingTexture;
+	bool v1 = size >= 4 && std::memcmp(data, "RCM", 4) == 0;
+
+	if (v1) {
+		// version 1: names and sizes packed one after the other, a char a side, then the cells
+		if (size < MAP_V1_CELLS)
+			throw std::runtime_error("File is not valid");
+
+		width = (unsigned char)data[44];
+		height = (unsigned char)data[45];
+		floorColor = ReadColor((const sf::Uint8 *)data + 46);
+		ceilingColor = ReadColor((const sf::Uint8 *)data + 49);
+		regionName = ReadName(data + 4, 20);
+		mapName = ReadName(data + 24, 20);
+		texture = ReadName(data + 52, 20);
+
+		cellOffset = MAP_V1_CELLS;
+		entityOffset = cellOffset + width*height*4 + 4;
+		entityCount = 0;
+		if (entityOffset <= size)
+			std::memcpy(&entityCount, data + entityOffset - 4, 4);
+	} else {
+		MapHeader header;
+		size_t first = offsetof(MapHeader, cellEncoding);
+		if (size < first)
+			throw std::runtime_error("File is not valid");
+
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(&header, data, first);
+		if (std::memcmp(header.magic, MAP_MAGIC, 4) != 0 || header.version != MAP_VERSION || header.headerSize < first || header.headerSize > size)
+			throw std::runtime_error("File is not valid");
+
+		std::memcpy(&header, data, std::min((size_t)header.headerSize, sizeof(header)));
+
+		width = header.width;
+		height = header.height;
+		floorColor = ReadColor(header.floorColor);
+		ceilingColor = ReadColor(header.ceilingColor);
+		regionName = ReadName(header.region, sizeof(header.region));
+		mapName = ReadName(header.map, sizeof(header.map));
+		texture = ReadName(header.texture, sizeof(header.texture));
+		floorTexture = header.floorTexture;
+		ceilingTexture = header.ceilingTexture;
+
+		cellOffset = header.cellOffset;
+		entityOffset = header.entityOffset;
+		entityCount = header.entityCount;
+		encoding = header.cellEncoding;
+		chunkCells = header.chunkCells;
+		planeOffset = header.planeOffset;
+		doorCount = header.doorCount;
+		maxDistance = header.maxDistance;
+		visibleOffset = header.visibleOffset;
+		visibleSize = header.visibleSize;
+
+		if (header.tileWidth != 0 || header.tileHeight != 0) {
+			tileWidth = header.tileWidth;
+			tileHeight = header.tileHeight;
+		}
+	}
 
-	char magic[4], region[20], map[20], width, height, tex[20];
-	sf::Color fcol, ccol;
-	unsigned int ec;
+	// everything the header points at has to be in the file
+	if (width == 0 || height == 0 || width > MAP_MAX_CELLS || height > MAP_MAX_CELLS || width*height > MAP_MAX_CELLS)
+		throw std::runtime_error("File is not valid");
 
-	// read the magic number
-	file.read(magic, 4);
-	if (std::strcmp(magic, "RCM") != 0)
+	int cells = (int)(width*height);
+	if (encoding == (sf::Uint32)MapEncoding::RAW) {
+		if (cellOffset % 4 != 0 || cellOffset > size || (sf::Uint64)cells*4 > size - cellOffset)
+			throw std::runtime_error("File is not valid");
+	} else if (encoding == (sf::Uint32)MapEncoding::CHUNKED) {
+		if (chunkCells == 0 || cellOffset > size || ((sf::Uint64)cells + chunkCells - 1)/chunkCells*sizeof(MapChunk) > size - cellOffset)
+			throw std::runtime_error("File is not valid");
+	} else
 		throw std::runtime_error("File is not valid");
 
-	m_FileName = filename;
+	// stored planes are taken as they are once they fit and have their borders, a wrong cell
+	// inside can only draw wrong (see GetBorderDistance)
+	if (planeOffset != 0) {
+		size_t planeSize = GetPlaneLayout((int)width, (int)height).size;
+		if (planeOffset % MAP_CELL_ALIGN != 0 || planeOffset > size || planeSize > size - planeOffset || doorCount > (sf::Uint32)cells || maxDistance > 255
+			|| !HasBorders(data + planeOffset, (int)width, (int)height))
+			throw std::runtime_error("File is not valid");
+	}
 
-	// read the region and map name
-	file.read(region, 20).read(map, 20);
+	// stored visible sets only have to fit the map, they cannot point anywhere
+	VisibleSet visible;
+	if (visibleOffset != 0) {
+		if (visibleOffset > size || visibleSize > size - visibleOffset || !visible.Read((int)width, (int)height, data + visibleOffset, (size_t)visibleSize))
+			throw std::runtime_error("File is not valid");
+	}
 
-	// read the map width and height
-	file.read(&width, 1).read(&height, 1);
+	// cut the sheet into column-major textures for the renderer
+	sf::Image *sheet = ResourceLoader::GetImage(texture);
+	if (!FitsTile(*sheet, tileWidth, tileHeight))
+		throw std::runtime_error("Texture does not hold a tile");
 
-	// read the floor and ceiling color
-	file.read((char *)&fcol, 3).read((char *)&ccol, 3);
+	WallAtlas atlas;
+	atlas.Create(*sheet, (int)tileWidth, (int)tileHeight);
 
-	// read the wall texture
-	file.read(tex, 20);
-	sf::Image *t = ResourceLoader::GetImage(tex);
-	m_TexWidth = t->getSize().x;
-	m_TexHeight = t->getSize().y;
+	// raw cells are used where they lie, chunks are decoded apart
+	std::vector<int> decoded;
+	if (encoding == (sf::Uint32)MapEncoding::CHUNKED) {
+		decoded.resize(cells);
+		if (!DecodeChunks(data, size, (size_t)cellOffset, (int)std::min(chunkCells, (sf::Uint32)cells), decoded))
+			throw std::runtime_error("File is not valid");
+	}
 
-	// create the map array and load the data in
-	if (m_Array)
-		delete[] m_Array;
+	// door state starts out all zeros, which costs nothing until a door opens
+	MappedFile doors;
+	doors.Allocate(AlignCells(cells) + (size_t)cells*sizeof(float));
 
-	m_Array = new int[width*height];
-	file.read((char *)m_Array, width*height*4);
+	// the file checks out, take it
+	m_File.Swap(file);
+	m_Cells.swap(decoded);
+	m_Array = m_Cells.empty() ? (int *)(m_File.GetData() + cellOffset) : m_Cells.data();
+	data = m_File.GetData();
+
+	m_FileName = filename;
+	m_RegionName = regionName;
+	m_MapName = mapName;
+	m_Texture = texture;
+	m_WallAtlas = std::move(atlas);
+	m_FloorColor = floorColor;
+	m_CeilingColor = ceilingColor;
+	m_FloorTexture = floorTexture;
+	m_CeilingTexture = ceilingTexture;
+
+	m_Height = (int)height;
+	m_Width = (int)width;
+
+	// the planes the file has, or ones split from the cells
+	if (planeOffset != 0) {
+		std::vector<sf::Uint64>().swap(m_PlaneStore);
+		UsePlanes(data + planeOffset);
+		m_DoorCount = (int)doorCount;
+		m_MaxDistance = (int)maxDistance;
+	} else
+		BuildPlanes();
+
+	// files without sets get them worked out here if that is quick, large maps have to wait
+	// for a save and see everything until then
+	if (visibleOffset != 0)
+		m_VisibleSet = std::move(visible);
+	else if (cells <= PVS_MAX_SQUARES)
+		m_VisibleSet.Build(*this);
+	else
+		m_VisibleSet.Clear();
+
+	// entities are only listed for now
+	size_t entitySize = v1 ? 17 : sizeof(MapEntity);
+	for (sf::Uint32 i=0; i<entityCount && entityOffset <= size && (i + 1)*entitySize <= size - entityOffset; ++i) {
+		const char *e = data + entityOffset + i*entitySize;
+		sf::Vector2f pos, dir;
+		unsigned int id;
+
+		if (v1) {
+			id = (unsigned char)e[0];
+			std::memcpy(&pos, e + 1, 8);
+			std::memcpy(&dir, e + 9, 8);
+		} else {
+			MapEntity entity;
+			std::memcpy(&entity, e, sizeof(entity));
+			id = entity.id;
+			pos = sf::Vector2f(entity.position[0], entity.position[1]);
+			dir = sf::Vector2f(entity.direction[0], entity.direction[1]);
+		}
+
+		std::cout << "Loaded entity (" << id << ") at (" << pos.x << ", " << pos.y << "), forward: (" << dir.x << ", " << dir.y << ")" << std::endl;
+	}
 
-	m_CeilingColor = ccol;
-	m_FloorColor = fcol;
-	m_Height = height;
-	m_Width = width;
-	m_MapName = std::string(map);
-	m_RegionName = std::string(region);
-	m_Texture = std::string(tex);
+	// clear the door data
+	m_Doors.Swap(doors);
+	m_DoorState = (sf::Uint8 *)m_Doors.GetData();
+	m_DoorAmount = (float *)(m_Doors.GetData() + AlignCells(cells));
+	m_MovingDoors.clear();
 
-	// read the entity count
-	file.read((char *)&ec, 4);
+	// a new map counts as changing everything
+	m_Changes.clear();
+	m_LogStart = ++m_Revision;
+}
 
-	// read the entity data in
-	for (unsigned int i=0; i<ec; ++i) {
-		unsigned char id;
-		sf::Vector2f pos, dir;
+bool Map::DecodeChunks(const char *data, size_t size, size_t indexOffset, int chunkCells, std::vector<int> &cells) const {
+	int total = (int)cells.size();
+	int chunks = (total + chunkCells - 1)/chunkCells;
+	std::atomic<bool> valid(true);
 
-		// read id
-		id = file.get();
+	// chunks decode on their own, each straight into its part of the cells
+	auto decode = [&](int begin, int end) {
+		for (int c = begin; c < end; c++) {
+			MapChunk chunk;
+			std::memcpy(&chunk, data + indexOffset + c*sizeof(MapChunk), sizeof(chunk));
 
-		// read position and direction
-		file.read((char *)&pos, 8).read((char *)&dir, 8);
+			int first = c*chunkCells;
+			int count = std::min(chunkCells, total - first);
+			if (chunk.offset > size || chunk.size > size - chunk.offset || !CellCodec::Decode(data + chunk.offset, chunk.size, (sf::Uint32 *)&cells[first], count))
+				valid = false;
+		}
+	};
 
-		std::cout << "Loaded entity (" << (unsigned int)id << ") at (" << pos.x << ", " << pos.y << "), forward: (" << dir.x << ", " << dir.y << ")" << std::endl;
-	}
+	if (m_ThreadPool)
+		m_ThreadPool->ParallelFor(chunks, chunks, decode);
+	else
+		decode(0, chunks);
 
-	// clear the door data
-	m_MovingDoors.clear();
-	m_OpenDoors.clear();
+	return valid;
 }
 
 void Map::Reload() {
 	Load(m_FileName);
 }
 
+void Map::SetThreadPool(ThreadPool *pool) {
+	m_ThreadPool = pool;
+}
\ No newline at end of file
@@ -1,11 +1,35 @@
 #pragma once
 
 #include "Sprite.hpp"
+#include "WallAtlas.hpp"
+#include "VisibleSet.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
 
 #include <SFML/Graphics.hpp>
 #include <string>
-#include <map>
-#include <set>
+#include <vector>
+#include <deque>
+#include <utility>
+
+// bytes readable past the last cell of the distance field, gathers load 4 at a time
+#define DISTANCE_FIELD_PAD 3
+
+// map files are RCM version 2: a header with 32-bit sizes, then the cells on a MAP_CELL_ALIGN
+// boundary, so a mapped file is used as is. version 1 files still load
+#define MAP_MAGIC "RCM2"
+#define MAP_VERSION 2
+#define MAP_CELL_ALIGN 64
+
+// texel size of the textures in the wall sheet, for files that do not give one (every version 1
+// file, and version 2 files written before the header held it)
+#define MAP_TILE_SIZE 64
+
+// cells per chunk when saving compressed
+#define MAP_CHUNK_CELLS (1 << 16)
+
+// cells are indexed by int, and a few planes hold an int per cell
+#define MAP_MAX_CELLS (1 << 28)
 
 enum class WallFlags : int {
 	COLLIDE = 0x01,
@@ -13,6 +37,12 @@ enum class WallFlags : int {
 	SECRET	= 0x04,
 };
 
+// per cell door state, kept apart from the cells as it is not saved
+enum class DoorState : sf::Uint8 {
+	OPEN	= 0x01,
+	MOVING	= 0x02,
+};
+
 struct Wall {
 	union {
 		unsigned value;
@@ -35,7 +65,8 @@ class Player;
 
 class Map {
 public:
-	Map(const std::string &filename, Player *player);
+	// compressed chunks are decoded on the pool if one is given, here and on every later load
+	Map(const std::string &filename, Player *player, ThreadPool *pool = nullptr);
 	~Map();
 
 	void Tick(float dt);
@@ -45,11 +76,22 @@ public:
 	void Set(int x, int y, Wall value);
 	void Set(int p, Wall value);
 
+	// if (x, y) is a cell of the map
+	bool IsInside(int x, int y) const;
+
+	// by position this reads a bitmap with a solid border a cell wide, so x from -1 to the
+	// width (and y likewise) needs no bounds check and is a wall off the map
 	bool IsWall(int x, int y) const;
 	bool IsWall(int p) const;
 	bool IsDoor(int x, int y) const;
 	bool IsDoor(int p) const;
 
+	// walls block sight, doors never do, even shut, as they can open without a Set
+	bool BlocksSight(int p) const;
+
+	// texture number of one side of a cell, counted north, east, south, west as in Wall
+	int GetFaceTexture(int p, int side) const;
+
 	void OpenDoor(int x, int y);
 	void OpenDoor(int p);
 
@@ -67,25 +109,102 @@ public:
 
 	int GetWidth() const;
 	int GetHeight() const;
+	const int *GetData() const;
+	// size of one wall texture, as cut from the sheet
 	int GetTexWidth() const;
 	int GetTexHeight() const;
 
+	// if any cell is a door, so the renderer can leave the door handling out when none is
+	bool HasDoors() const;
+
+	// per cell, the chessboard distance to the nearest wall (0 on walls, the map edge counts as
+	// one), capped at 255. every cell less than that from a cell is empty, so rays can leap across.
+	// rows are GetFieldStride() apart and a border of walls a cell wide goes around the map, so a
+	// ray can step off it without a bounds check
+	const sf::Uint8 *GetDistanceField() const;
+	int GetFieldStride() const;
+
+	// cells from (x, y) to that border, the most the field can hold there. a field read from a
+	// file is not checked cell by cell, so rays leap no further than this to stay on the map
+	int GetBorderDistance(int x, int y) const;
+
+	// which cells can be seen from which, as saved with the map. files without have them built
+	// on load, unless the map is over PVS_MAX_SQUARES cells: then they are built when it is saved,
+	// and every cell sees every other until then. sources a Set could change see everything
+	// until Tick has rebuilt them
+	const VisibleSet &GetVisibleSet() const;
+	bool CanSee(int from, int to) const;
+
 	const sf::Color &GetFloorColor() const;
 	const sf::Color &GetCeilingColor() const;
 
+	// texture numbers in the wall sheet for the whole floor and ceiling, counted from 1 like the
+	// wall sides, 0 keeps the flat colour. only version 2 files store them
+	int GetFloorTexture() const;
+	int GetCeilingTexture() const;
+	void SetFloorTexture(int tex);
+	void SetCeilingTexture(int tex);
+
+	// the wall sheet, cut into textures of tileWidth x tileHeight texels
+	void SetTexture(const std::string &texture, int tileWidth, int tileHeight);
+
 	sf::Image *GetWallImage() const;
+	const WallAtlas &GetWallAtlas() const;
 
 	void AddSprite(Sprite *spr);
 	const std::vector<Sprite *> &GetSprites() const;
 	void SortSprites(const sf::Vector2f &pos);
 
+	// sort any list of sprites back to front from pos, as SortSprites does the map's
+	static void SortSprites(std::vector<Sprite *> &sprites, const sf::Vector2f &pos);
+
+	// bumped whenever a cell or a door changes
+	unsigned int GetRevision() const;
+
+	// cells changed after revision `since`, false if the change log no longer reaches back that far
+	bool GetChangedCells(unsigned int since, std::vector<int> &cells) const;
+
+	// saving always writes version 2, to a new file that then replaces the old one. compressed
+	// the cells are cut into chunks of MAP_CHUNK_CELLS, each run-length coded (CellCodec). the
+	// visible sets are brought up to date (built, for a large map loaded without them) and saved
+	// too. a file that cannot be written throws, and whatever was there before stays
 	void Save();
-	void Save(const std::string &filename);
+	void Save(const std::string &filename, bool compressed = true);
+
+	// the file is mapped and raw cells used in place, edits are kept in memory until saved. raw
+	// saves store the planes and distance field after the cells, and those are used in place
+	// too, so a raw file loads without a pass over its cells. either kind stores the visible sets. compressed chunks are decoded in
+	// parallel on the map's pool, one after the other without one, and the planes built from them.
+	// a file that cannot be opened or is not valid throws and leaves the map as it was
 	void Load(const std::string &filename);
 	void Reload();
 
+	void SetThreadPool(ThreadPool *pool);
+
+private:
+	void MarkChanged(int p);
+
+	// decode the chunks listed at indexOffset into cells, false if any is damaged
+	bool DecodeChunks(const char *data, size_t size, size_t indexOffset, int chunkCells, std::vector<int> &cells) const;
+
+	// recompute the distance field over [x0, x1) x [y0, y1), the cells around it holding
+	void UpdateDistanceField(int x0, int y0, int x1, int y1);
+
+	// point the planes below into a block laid out for the map's size, or build them all into
+	// m_PlaneStore from the cells
+	void UsePlanes(char *planes);
+	void BuildPlanes();
+
+	// bring the planes below up to date with cell p
+	void UpdatePlanes(int p);
+	void UpdatePlanes(int x, int y);
+	void SetSolid(int x, int y, bool solid);
+
 private:
+	MappedFile				m_File;
+	std::vector<int>		m_Cells;		// decoded, unless the cells are the file's
 	int						*m_Array;
+	ThreadPool				*m_ThreadPool;
 	int						m_Width;
 	int						m_Height;
 
@@ -94,16 +213,42 @@ private:
 	std::string				m_MapName;
 
 	std::string				m_Texture;
-	int						m_TexWidth;
-	int						m_TexHeight;
+	WallAtlas				m_WallAtlas;
+	int						m_DoorCount;
+
+	// the cells split into planes for the renderer: a bit per cell with the border (rows of
+	// m_SolidStride words), the flags, and each side's texture, only read once a ray hits. they
+	// and the distance field lie in one block as a raw file stores them, the file's own pages
+	// when it has them, m_PlaneStore when they were built
+	std::vector<sf::Uint64>	m_PlaneStore;
+	char					*m_Planes;
+	sf::Uint64				*m_Solid;
+	int						m_SolidStride;
+	sf::Uint8				*m_Flags;
+	sf::Uint8				*m_Faces[4];
+
+	sf::Uint8				*m_DistanceField;
+	int						m_FieldStride;
+	int						m_MaxDistance;
+	VisibleSet				m_VisibleSet;
 
 	sf::Color				m_FloorColor;
 	sf::Color				m_CeilingColor;
+	int						m_FloorTexture;
+	int						m_CeilingTexture;
 
 	Player					*m_Player;
 	std::vector<Sprite *>	m_Sprites;
 
-	// unsaved values
-	std::map<int, float>	m_MovingDoors;
-	std::set<int>			m_OpenDoors;
+	// unsaved values: DoorState bits and how far each door has slid, per cell, in pages of zeros
+	// only backed where doors open, and the cells of the moving doors in the order they started
+	MappedFile				m_Doors;
+	sf::Uint8				*m_DoorState;
+	float					*m_DoorAmount;
+	std::vector<int>		m_MovingDoors;
+
+	// (revision, cell) of recent changes, every change after m_LogStart is in it
+	unsigned int						m_Revision;
+	unsigned int						m_LogStart;
+	std::deque<std::pair<unsigned int, int> >	m_Changes;
 };
\ No newline at end of file
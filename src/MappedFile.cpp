@@ -0,0 +1,119 @@
+#include "MappedFile.hpp"
+
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPEDFILE_MMAP
+#endif
+
+MappedFile::MappedFile()
+	: m_Data(nullptr), m_Size(0), m_Mapped(false)
+{
+
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(const std::string &filename) {
+	Close();
+
+#ifdef MAPPEDFILE_MMAP
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		// private and writable, pages written to are copied rather than reaching the file
+		void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+		if (data != MAP_FAILED) {
+			// it is about to be read through, start reading ahead (populating would copy every page)
+			madvise(data, (size_t)st.st_size, MADV_WILLNEED);
+
+			m_Data = (char *)data;
+			m_Size = (size_t)st.st_size;
+			m_Mapped = true;
+			close(fd);
+			return true;
+		}
+	}
+
+	close(fd);
+#endif
+
+	// no mapping, read it all
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	m_Buffer.resize((size_t)file.tellg());
+	file.seekg(0).read(m_Buffer.data(), m_Buffer.size());
+
+	m_Data = m_Buffer.data();
+	m_Size = m_Buffer.size();
+	return true;
+}
+
+void MappedFile::Allocate(size_t size) {
+	Close();
+
+#ifdef MAPPEDFILE_MMAP
+	if (size > 0) {
+		void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (data != MAP_FAILED) {
+			m_Data = (char *)data;
+			m_Size = size;
+			m_Mapped = true;
+			return;
+		}
+	}
+#endif
+
+	m_Buffer.assign(size, 0);
+	m_Data = m_Buffer.data();
+	m_Size = m_Buffer.size();
+}
+
+void MappedFile::Close() {
+#ifdef MAPPEDFILE_MMAP
+	if (m_Mapped)
+		munmap(m_Data, m_Size);
+#endif
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Mapped = false;
+	std::vector<char>().swap(m_Buffer);
+}
+
+void MappedFile::Swap(MappedFile &other) {
+	std::swap(m_Data, other.m_Data);
+	std::swap(m_Size, other.m_Size);
+	std::swap(m_Mapped, other.m_Mapped);
+	m_Buffer.swap(other.m_Buffer);
+}
+
+char *MappedFile::GetData() {
+	return m_Data;
+}
+
+const char *MappedFile::GetData() const {
+	return m_Data;
+}
+
+size_t MappedFile::GetSize() const {
+	return m_Size;
+}
+
+bool MappedFile::IsMapped() const {
+	return m_Mapped;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// a whole file in memory, mapped copy-on-write where the system allows it so nothing is read
+// until it is touched and writes stay private to the process, read into a buffer where it does not
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	// false if the file cannot be opened, what was open before is closed either way
+	bool Open(const std::string &filename);
+	void Close();
+
+	// size bytes of zeros instead of a file, mapped anonymously where the system allows it so
+	// pages are only backed once written to, what was open before is closed
+	void Allocate(size_t size);
+
+	// trade files with another, the data of each stays where it is
+	void Swap(MappedFile &other);
+
+	char *GetData();
+	const char *GetData() const;
+	size_t GetSize() const;
+
+	// if the data is the file's pages (or the system's, when allocated), which only stay valid
+	// while the file is not rewritten in place: replace it (write elsewhere and rename) instead
+	bool IsMapped() const;
+
+private:
+	MappedFile(const MappedFile &);
+
+private:
+	char				*m_Data;
+	size_t				m_Size;
+	bool				m_Mapped;
+	std::vector<char>	m_Buffer;
+};
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "Palette.hpp"
+#include "FrameBuffer.hpp"
+#include "ShadeTable.hpp"
+#include "RayCaster.hpp"
+
+#include <climits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PALETTE_SIMD
+#include <immintrin.h>
+#endif
+
+sf::Uint32 Palette::m_Colors[256];
+sf::Uint8 Palette::m_Inverse[32*32*32];
+sf::Uint8 Palette::m_Colormaps[2*256*256 + PALETTE_GATHER_PAD];
+std::once_flag Palette::m_Loaded;
+bool Palette::m_Enabled = false;
+
+void Palette::SetEnabled(bool enabled) {
+	m_Enabled = enabled;
+}
+
+bool Palette::IsEnabled() {
+	return m_Enabled;
+}
+
+const sf::Uint32 *Palette::GetColors() {
+	std::call_once(m_Loaded, Load);
+
+	return m_Colors;
+}
+
+sf::Uint8 Palette::Match(sf::Uint32 pixel) {
+	std::call_once(m_Loaded, Load);
+	return Nearest(pixel);
+}
+
+const sf::Uint8 *Palette::GetColormap(int mod, bool side) {
+	std::call_once(m_Loaded, Load);
+
+	return &m_Colormaps[((side ? 256 : 0) + mod)*256];
+}
+
+#ifdef PALETTE_SIMD
+__attribute__((target("avx2")))
+static void ResolveAVX2(const sf::Uint32 *colors, const sf::Uint8 *indices, sf::Uint32 *pixels, int count) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(indices + i)));
+		_mm256_storeu_si256((__m256i *)(pixels + i), _mm256_i32gather_epi32((const int *)colors, idx, 4));
+	}
+
+	for (; i < count; i++)
+		pixels[i] = colors[indices[i]];
+}
+#endif
+
+void Palette::Resolve(const sf::Uint8 *indices, sf::Uint32 *pixels, int count) {
+	std::call_once(m_Loaded, Load);
+
+#ifdef PALETTE_SIMD
+	if (RayCaster::GetMode() == PacketMode::AVX2) {
+		ResolveAVX2(m_Colors, indices, pixels, count);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < count; i++)
+		pixels[i] = m_Colors[indices[i]];
+}
+
+sf::Uint8 Palette::Nearest(sf::Uint32 pixel) {
+	const sf::Uint8 *b = (const sf::Uint8 *)&pixel;
+	return m_Inverse[((b[0] >> 3) << 10) | ((b[1] >> 3) << 5) | (b[2] >> 3)];
+}
+
+// runs once, whichever thread gets here first fills the tables while the rest wait
+void Palette::Load() {
+	sf::Image image;
+	bool ok = image.loadFromFile(PALETTE_FILE) && image.getSize().x*image.getSize().y == 256;
+
+	for (int i=0; i<256; ++i) {
+		if (ok)
+			m_Colors[i] = PackColor(image.getPixel(i%16, i/16));
+		else
+			m_Colors[i] = PackColor(sf::Color((i >> 5)*255/7, ((i >> 2) & 7)*255/7, (i & 3)*255/3));
+	}
+
+	// nearest entry to every 5 bit colour, stretched so black and white stay exact
+	for (int c=0; c<32*32*32; ++c) {
+		int r = (c >> 10)*255/31;
+		int g = ((c >> 5) & 31)*255/31;
+		int b = (c & 31)*255/31;
+
+		int best = 0;
+		int bestDist = INT_MAX;
+
+		for (int i=0; i<256; ++i) {
+			const sf::Uint8 *p = (const sf::Uint8 *)&m_Colors[i];
+			int dist = (p[0] - r)*(p[0] - r) + (p[1] - g)*(p[1] - g) + (p[2] - b)*(p[2] - b);
+
+			if (dist < bestDist) {
+				best = i;
+				bestDist = dist;
+			}
+		}
+
+		m_Inverse[c] = (sf::Uint8)best;
+	}
+
+	for (int side=0; side<2; ++side)
+		for (int mod=0; mod<256; ++mod)
+			for (int i=0; i<256; ++i)
+				m_Colormaps[(side*256 + mod)*256 + i] = Nearest(ShadeTable::Apply(m_Colors[i], ShadeTable::Get(mod, side != 0)));
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <mutex>
+#include <SFML/Graphics.hpp>
+
+// the shared palette, a 16x16 image of the 256 colours, entry 0 black
+#define PALETTE_FILE "Images/palette.png"
+
+// bytes past the end of index textures and colormaps, so a 4 byte gather at the last one stays in bounds
+#define PALETTE_GATHER_PAD 3
+
+// the 256 colours of the 8-bit pipeline, with colormaps doing for palette indices what
+// ShadeTable does for packed pixels. loaded on first use, a colour cube if the file is missing
+class Palette {
+public:
+	// textures only get index copies while the palette is enabled, so enable it before any
+	// are loaded if frames will be drawn palettized. off by default
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	// packed colour of each index
+	static const sf::Uint32 *GetColors();
+
+	// the index closest to a packed pixel, alpha is ignored
+	static sf::Uint8 Match(sf::Uint32 pixel);
+
+	// 256 entries mapping an index to the index closest to its colour shaded as ShadeTable::Get(mod, side)
+	static const sf::Uint8 *GetColormap(int mod, bool side);
+
+	// turn count indices into packed pixels, in packets picked like RayCaster's
+	static void Resolve(const sf::Uint8 *indices, sf::Uint32 *pixels, int count);
+
+private:
+	static void Load();
+	static sf::Uint8 Nearest(sf::Uint32 pixel);
+
+	static sf::Uint32		m_Colors[256];
+	static sf::Uint8		m_Inverse[32*32*32];	// 5 bits per channel
+	static sf::Uint8		m_Colormaps[2*256*256 + PALETTE_GATHER_PAD];	// [side][mod][index]
+	static std::once_flag	m_Loaded;
+	static bool				m_Enabled;
+};
\ No newline at end of file
@@ -95,6 +95,21 @@ float Player::GetAngle() const {
 	return std::atan2(m_Forward.y, m_Forward.x);
 }
 
+float Player::GetFOV() const {
+	return m_FOV;
+}
+
+Camera Player::GetCamera() const {
+	Camera cam;
+	cam.position = m_Position;
+	cam.forward = m_Forward;
+	cam.right = m_Right;
+	cam.fov = m_FOV;
+	cam.height = m_Height;
+
+	return cam;
+}
+
 unsigned int Player::GetAmmo(const std::string &type) const {
 	if (m_Ammo.count(type) == 1) {
 		return m_Ammo.at(type);
@@ -4,6 +4,7 @@
 
 #include <SFML/System/Vector2.hpp>
 #include "Map.hpp"
+#include "Camera.hpp"
 
 class Player {
 public:
@@ -16,6 +17,9 @@ public:
 	const sf::Vector2f &GetForward() const;
 	sf::Vector2f GetRight() const;
 	float GetAngle() const;
+	float GetFOV() const;
+
+	Camera GetCamera() const;
 
 	unsigned int GetAmmo(const std::string &type) const;
 	void SetAmmo(const std::string &type, unsigned int n);
@@ -0,0 +1,649 @@
+#include "RayCaster.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAYCASTER_SIMD
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+PacketMode RayCaster::m_Mode = RayCaster::GetBestMode();
+
+RayTable::RayTable()
+	: m_Width(0), m_FOV(0.f), m_FogDistance(0.f)
+{
+
+}
+
+void RayTable::Update(const Camera &cam, int screenWidth, float fogDistance) {
+	bool rotate = cam.forward != m_Forward || cam.right != m_Right;
+	bool fog = fogDistance != m_FogDistance;
+
+	if (screenWidth != m_Width || cam.fov != m_FOV) {
+		m_Width = screenWidth;
+		m_FOV = cam.fov;
+
+		m_CameraX.resize(screenWidth);
+		m_Length.resize(screenWidth);
+		m_DoorCos.resize(screenWidth);
+		m_RayDirX.resize(screenWidth);
+		m_RayDirY.resize(screenWidth);
+		m_DeltaDistX.resize(screenWidth);
+		m_DeltaDistY.resize(screenWidth);
+		m_MaxDist.resize(screenWidth);
+
+		// the right vector is tan(fov/2) long and square to a unit forward
+		float t = std::tan(cam.fov/2.f);
+
+		for (int x=0; x<screenWidth; ++x) {
+			float cameraX = 2.f*x/float(screenWidth)-1.f; //x-coordinate in camera space
+
+			m_CameraX[x] = cameraX;
+			m_Length[x] = std::sqrt(1.f + cameraX*cameraX*t*t);
+			m_DoorCos[x] = std::cos((x - screenWidth/2)*(cam.fov/(float)screenWidth));
+		}
+
+		rotate = true;
+		fog = true;
+	}
+
+	// distances along the rays are |ray| times the straight ahead ones
+	if (fog) {
+		m_FogDistance = fogDistance;
+
+		for (int x=0; x<screenWidth; ++x)
+			m_MaxDist[x] = fogDistance*m_Length[x];
+	}
+
+	if (!rotate)
+		return;
+
+	m_Forward = cam.forward;
+	m_Right = cam.right;
+
+	// a ray crosses a whole cell in x after |ray|/|rayDirX|, turning only needs the directions again
+	for (int x=0; x<screenWidth; ++x) {
+		float rayDirX = m_Forward.x + m_Right.x*m_CameraX[x];
+		float rayDirY = m_Forward.y + m_Right.y*m_CameraX[x];
+
+		m_RayDirX[x] = rayDirX;
+		m_RayDirY[x] = rayDirY;
+		m_DeltaDistX[x] = std::min(m_Length[x]/std::abs(rayDirX), RAY_MAX_DELTA);
+		m_DeltaDistY[x] = std::min(m_Length[x]/std::abs(rayDirY), RAY_MAX_DELTA);
+	}
+}
+
+int RayTable::GetWidth() const {
+	return m_Width;
+}
+
+const float *RayTable::GetRayDirX() const {
+	return m_RayDirX.data();
+}
+
+const float *RayTable::GetRayDirY() const {
+	return m_RayDirY.data();
+}
+
+const float *RayTable::GetDeltaDistX() const {
+	return m_DeltaDistX.data();
+}
+
+const float *RayTable::GetDeltaDistY() const {
+	return m_DeltaDistY.data();
+}
+
+const float *RayTable::GetDoorCos() const {
+	return m_DoorCos.data();
+}
+
+const float *RayTable::GetMaxDist() const {
+	return m_MaxDist.data();
+}
+
+void RayCaster::Setup(const RayTable &table, const Camera &cam, int x, Ray &ray) {
+	const sf::Vector2f &pos = cam.position;
+
+	// ray direction and cell crossing lengths come straight from the table
+	ray.rayDirX = table.GetRayDirX()[x];
+	ray.rayDirY = table.GetRayDirY()[x];
+	ray.deltaDistX = table.GetDeltaDistX()[x];
+	ray.deltaDistY = table.GetDeltaDistY()[x];
+	ray.maxDist = table.GetMaxDist()[x];
+
+	ray.mapX = int(pos.x);
+	ray.mapY = int(pos.y);
+
+	// calculate step and initial sideDist
+	if (ray.rayDirX < 0) {
+		ray.stepX = -1;
+		ray.sideDistX = (pos.x - ray.mapX) * ray.deltaDistX;
+	} else {
+		ray.stepX = 1;
+		ray.sideDistX = (ray.mapX + 1.0f - pos.x) * ray.deltaDistX;
+	}
+
+	if (ray.rayDirY < 0) {
+		ray.stepY = -1;
+		ray.sideDistY = (pos.y - ray.mapY) * ray.deltaDistY;
+	} else {
+		ray.stepY = 1;
+		ray.sideDistY = (ray.mapY + 1.0f - pos.y) * ray.deltaDistY;
+	}
+
+	ray.startDistX = ray.sideDistX;
+	ray.startDistY = ray.sideDistY;
+	ray.stepsX = 0;
+	ray.stepsY = 0;
+
+	ray.side = false;
+	ray.hit = false;
+}
+
+// how many of r crossings of one axis, from `steps` on, come before another at `limit`
+static int CountCrossings(float startDist, float deltaDist, int steps, int r, float limit, bool ties) {
+	// the crossings only grow, so search for the first one that does not
+	int lo = 0;
+	int hi = r;
+
+	while (lo < hi) {
+		int mid = (lo + hi)/2;
+		float d = startDist + (float)(steps + mid)*deltaDist;
+
+		if (d < limit || (ties && d == limit))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+void RayCaster::Leap(Ray &ray, int r) {
+	// the crossings that would leave the square either way
+	float exitX = ray.startDistX + (float)(ray.stepsX + r)*ray.deltaDistX;
+	float exitY = ray.startDistY + (float)(ray.stepsY + r)*ray.deltaDistY;
+
+	// the steps take an x-side only if it is strictly nearer, so y-sides win ties
+	int stepsX, stepsY;
+	if (exitX < exitY) {
+		stepsX = ray.stepsX + r;
+		stepsY = ray.stepsY + CountCrossings(ray.startDistY, ray.deltaDistY, ray.stepsY, r, exitX, true);
+	} else {
+		stepsY = ray.stepsY + r;
+		stepsX = ray.stepsX + CountCrossings(ray.startDistX, ray.deltaDistX, ray.stepsX, r, exitY, false);
+	}
+
+	ray.mapX += (stepsX - ray.stepsX)*ray.stepX;
+	ray.mapY += (stepsY - ray.stepsY)*ray.stepY;
+	ray.stepsX = stepsX;
+	ray.stepsY = stepsY;
+	ray.sideDistX = ray.startDistX + (float)stepsX*ray.deltaDistX;
+	ray.sideDistY = ray.startDistY + (float)stepsY*ray.deltaDistY;
+}
+
+bool RayCaster::Trace(const Map &map, Ray &ray) {
+	const sf::Uint8 *field = map.GetDistanceField();
+	int stride = map.GetFieldStride();
+
+	// rays from off the map see nothing, on it the border around the map stops them
+	if (!map.IsInside(ray.mapX, ray.mapY)) {
+		ray.hit = false;
+		return false;
+	}
+
+	// how far the ray's cell is from a wall
+	int dist = field[ray.mapY*stride + ray.mapX];
+
+	// perform DDA
+	while (true) {
+		// never off the map, whatever a field from a file says
+		if (dist - 1 >= LEAP_MIN_RADIUS)
+			Leap(ray, std::min(dist, map.GetBorderDistance(ray.mapX, ray.mapY)) - 1);
+
+		// nothing is seen past the fog
+		if (std::min(ray.sideDistX, ray.sideDistY) >= ray.maxDist) {
+			ray.hit = false;
+			return false;
+		}
+
+		// jump to next map square, OR in x-direction, OR in y-direction
+		if (ray.sideDistX < ray.sideDistY) {
+			ray.stepsX++;
+			ray.sideDistX = ray.startDistX + (float)ray.stepsX*ray.deltaDistX;
+			ray.mapX += ray.stepX;
+			ray.side = false;
+		} else {
+			ray.stepsY++;
+			ray.sideDistY = ray.startDistY + (float)ray.stepsY*ray.deltaDistY;
+			ray.mapY += ray.stepY;
+			ray.side = true;
+		}
+
+		// Check if ray has hit a wall, the only cells no distance from one. the border
+		// reads as a wall, so that is where a ray leaves the map
+		dist = field[ray.mapY*stride + ray.mapX];
+		if (dist == 0) {
+			ray.hit = map.IsInside(ray.mapX, ray.mapY);
+			return ray.hit;
+		}
+	}
+}
+
+bool RayCaster::InFog(const Map &map, const Ray &ray) {
+	return !ray.hit && map.IsInside(ray.mapX, ray.mapY);
+}
+
+#ifdef RAYCASTER_SIMD
+// the packet paths do exactly the scalar arithmetic, in the same order, one lane per column,
+// so they land on the same cells with the same side distances as Setup and Trace
+
+// a packet's rays spread out per lane, for leaping single lanes with the scalar code
+struct alignas(32) PacketLanes {
+	float	sideDistX[8];
+	float	sideDistY[8];
+	float	startDistX[8];
+	float	startDistY[8];
+	float	deltaDistX[8];
+	float	deltaDistY[8];
+	int		mapX[8];
+	int		mapY[8];
+	int		stepX[8];
+	int		stepY[8];
+	int		stepsX[8];
+	int		stepsY[8];
+	int		dist[8];
+};
+
+static void LeapLanes(const Map &map, PacketLanes &lanes, int mask) {
+	for (int i=0; i<8; ++i) {
+		if (!(mask & (1 << i)))
+			continue;
+
+		Ray ray;
+		ray.sideDistX = lanes.sideDistX[i];
+		ray.sideDistY = lanes.sideDistY[i];
+		ray.startDistX = lanes.startDistX[i];
+		ray.startDistY = lanes.startDistY[i];
+		ray.deltaDistX = lanes.deltaDistX[i];
+		ray.deltaDistY = lanes.deltaDistY[i];
+		ray.mapX = lanes.mapX[i];
+		ray.mapY = lanes.mapY[i];
+		ray.stepX = lanes.stepX[i];
+		ray.stepY = lanes.stepY[i];
+		ray.stepsX = lanes.stepsX[i];
+		ray.stepsY = lanes.stepsY[i];
+
+		RayCaster::Leap(ray, std::min(lanes.dist[i], map.GetBorderDistance(ray.mapX, ray.mapY)) - 1);
+
+		lanes.sideDistX[i] = ray.sideDistX;
+		lanes.sideDistY[i] = ray.sideDistY;
+		lanes.mapX[i] = ray.mapX;
+		lanes.mapY[i] = ray.mapY;
+		lanes.stepsX[i] = ray.stepsX;
+		lanes.stepsY[i] = ray.stepsY;
+	}
+}
+
+__attribute__((target("sse4.1")))
+static void TracePacketSSE(const Map &map, const RayTable &table, const Camera &cam, int x, Ray *rays) {
+	const sf::Uint8 *field = map.GetDistanceField();
+	const sf::Vector2f &pos = cam.position;
+	int mapX0 = int(pos.x);
+	int mapY0 = int(pos.y);
+
+	__m128 zero = _mm_setzero_ps();
+
+	// ray directions for the four columns
+	__m128 rayDirX = _mm_loadu_ps(table.GetRayDirX() + x);
+	__m128 rayDirY = _mm_loadu_ps(table.GetRayDirY() + x);
+	__m128 deltaDistX = _mm_loadu_ps(table.GetDeltaDistX() + x);
+	__m128 deltaDistY = _mm_loadu_ps(table.GetDeltaDistY() + x);
+	__m128 maxDist = _mm_loadu_ps(table.GetMaxDist() + x);
+
+	// step is -1 (all bits set) for negative directions, 1 otherwise
+	__m128 negX = _mm_cmplt_ps(rayDirX, zero);
+	__m128 negY = _mm_cmplt_ps(rayDirY, zero);
+	__m128i stepX = _mm_or_si128(_mm_castps_si128(negX), _mm_set1_epi32(1));
+	__m128i stepY = _mm_or_si128(_mm_castps_si128(negY), _mm_set1_epi32(1));
+
+	__m128 startDistX = _mm_blendv_ps(_mm_mul_ps(_mm_set1_ps(mapX0 + 1.0f - pos.x), deltaDistX), _mm_mul_ps(_mm_set1_ps(pos.x - mapX0), deltaDistX), negX);
+	__m128 startDistY = _mm_blendv_ps(_mm_mul_ps(_mm_set1_ps(mapY0 + 1.0f - pos.y), deltaDistY), _mm_mul_ps(_mm_set1_ps(pos.y - mapY0), deltaDistY), negY);
+	__m128 sideDistX = startDistX;
+	__m128 sideDistY = startDistY;
+
+	__m128i mapX = _mm_set1_epi32(mapX0);
+	__m128i mapY = _mm_set1_epi32(mapY0);
+	__m128i width = _mm_set1_epi32(map.GetWidth());
+	__m128i height = _mm_set1_epi32(map.GetHeight());
+	__m128i stride = _mm_set1_epi32(map.GetFieldStride());
+	__m128i minusOne = _mm_set1_epi32(-1);
+	__m128i leapMin = _mm_set1_epi32(LEAP_MIN_RADIUS);
+
+	__m128i stepsX = _mm_setzero_si128();
+	__m128i stepsY = _mm_setzero_si128();
+	__m128i dist = _mm_set1_epi32(field[mapY0*map.GetFieldStride() + mapX0]);
+
+	__m128i active = minusOne;
+	__m128i side = _mm_setzero_si128();
+	__m128i hit = _mm_setzero_si128();
+
+	alignas(16) int idx[4];
+	alignas(16) int check[4];
+	PacketLanes lanes;
+
+	while (_mm_movemask_epi8(active)) {
+		// rays in wide empty squares leap across them, a lane at a time
+		__m128i leap = _mm_and_si128(_mm_cmpgt_epi32(dist, leapMin), active);
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(leap));
+
+		if (mask) {
+			_mm_store_ps(lanes.sideDistX, sideDistX);
+			_mm_store_ps(lanes.sideDistY, sideDistY);
+			_mm_store_ps(lanes.startDistX, startDistX);
+			_mm_store_ps(lanes.startDistY, startDistY);
+			_mm_store_ps(lanes.deltaDistX, deltaDistX);
+			_mm_store_ps(lanes.deltaDistY, deltaDistY);
+			_mm_store_si128((__m128i *)lanes.mapX, mapX);
+			_mm_store_si128((__m128i *)lanes.mapY, mapY);
+			_mm_store_si128((__m128i *)lanes.stepX, stepX);
+			_mm_store_si128((__m128i *)lanes.stepY, stepY);
+			_mm_store_si128((__m128i *)lanes.stepsX, stepsX);
+			_mm_store_si128((__m128i *)lanes.stepsY, stepsY);
+			_mm_store_si128((__m128i *)lanes.dist, dist);
+
+			LeapLanes(map, lanes, mask);
+
+			sideDistX = _mm_load_ps(lanes.sideDistX);
+			sideDistY = _mm_load_ps(lanes.sideDistY);
+			mapX = _mm_load_si128((const __m128i *)lanes.mapX);
+			mapY = _mm_load_si128((const __m128i *)lanes.mapY);
+			stepsX = _mm_load_si128((const __m128i *)lanes.stepsX);
+			stepsY = _mm_load_si128((const __m128i *)lanes.stepsY);
+		}
+
+		// rays reaching the fog are done
+		__m128 fog = _mm_cmpge_ps(_mm_min_ps(sideDistX, sideDistY), maxDist);
+		active = _mm_andnot_si128(_mm_castps_si128(fog), active);
+
+		// jump to next map square, OR in x-direction, OR in y-direction
+		__m128i xside = _mm_castps_si128(_mm_cmplt_ps(sideDistX, sideDistY));
+		__m128i mx = _mm_and_si128(xside, active);
+		__m128i my = _mm_andnot_si128(xside, active);
+
+		stepsX = _mm_sub_epi32(stepsX, mx);
+		stepsY = _mm_sub_epi32(stepsY, my);
+		sideDistX = _mm_add_ps(startDistX, _mm_mul_ps(_mm_cvtepi32_ps(stepsX), deltaDistX));
+		sideDistY = _mm_add_ps(startDistY, _mm_mul_ps(_mm_cvtepi32_ps(stepsY), deltaDistY));
+		mapX = _mm_add_epi32(mapX, _mm_and_si128(stepX, mx));
+		mapY = _mm_add_epi32(mapY, _mm_and_si128(stepY, my));
+		side = _mm_blendv_epi8(side, my, active);
+
+		// no gather before AVX2, read the distances one lane at a time
+		_mm_store_si128((__m128i *)idx, _mm_add_epi32(_mm_mullo_epi32(mapY, stride), mapX));
+		_mm_store_si128((__m128i *)check, active);
+
+		dist = _mm_setr_epi32(
+			check[0] ? field[idx[0]] : 0,
+			check[1] ? field[idx[1]] : 0,
+			check[2] ? field[idx[2]] : 0,
+			check[3] ? field[idx[3]] : 0);
+		__m128i wall = _mm_and_si128(_mm_cmpeq_epi32(dist, _mm_setzero_si128()), active);
+
+		// the border reads as a wall too, rays that reach it have left the map
+		if (_mm_movemask_epi8(wall)) {
+			__m128i inside = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(mapX, minusOne), _mm_cmpgt_epi32(width, mapX)),
+				_mm_and_si128(_mm_cmpgt_epi32(mapY, minusOne), _mm_cmpgt_epi32(height, mapY)));
+
+			hit = _mm_or_si128(hit, _mm_and_si128(wall, inside));
+			active = _mm_andnot_si128(wall, active);
+		}
+	}
+
+	alignas(16) float fs[9][4];
+	alignas(16) int is[8][4];
+	_mm_store_ps(fs[0], rayDirX);
+	_mm_store_ps(fs[1], rayDirY);
+	_mm_store_ps(fs[2], deltaDistX);
+	_mm_store_ps(fs[3], deltaDistY);
+	_mm_store_ps(fs[4], sideDistX);
+	_mm_store_ps(fs[5], sideDistY);
+	_mm_store_ps(fs[6], startDistX);
+	_mm_store_ps(fs[7], startDistY);
+	_mm_store_ps(fs[8], maxDist);
+	_mm_store_si128((__m128i *)is[0], mapX);
+	_mm_store_si128((__m128i *)is[1], mapY);
+	_mm_store_si128((__m128i *)is[2], stepX);
+	_mm_store_si128((__m128i *)is[3], stepY);
+	_mm_store_si128((__m128i *)is[4], side);
+	_mm_store_si128((__m128i *)is[5], hit);
+	_mm_store_si128((__m128i *)is[6], stepsX);
+	_mm_store_si128((__m128i *)is[7], stepsY);
+
+	for (int i=0; i<4; ++i) {
+		Ray &ray = rays[i];
+		ray.rayDirX = fs[0][i];
+		ray.rayDirY = fs[1][i];
+		ray.deltaDistX = fs[2][i];
+		ray.deltaDistY = fs[3][i];
+		ray.sideDistX = fs[4][i];
+		ray.sideDistY = fs[5][i];
+		ray.startDistX = fs[6][i];
+		ray.startDistY = fs[7][i];
+		ray.maxDist = fs[8][i];
+		ray.mapX = is[0][i];
+		ray.mapY = is[1][i];
+		ray.stepX = is[2][i];
+		ray.stepY = is[3][i];
+		ray.side = is[4][i] != 0;
+		ray.hit = is[5][i] != 0;
+		ray.stepsX = is[6][i];
+		ray.stepsY = is[7][i];
+	}
+}
+
+__attribute__((target("avx2")))
+static void TracePacketAVX2(const Map &map, const RayTable &table, const Camera &cam, int x, Ray *rays) {
+	const sf::Uint8 *field = map.GetDistanceField();
+	const sf::Vector2f &pos = cam.position;
+	int mapX0 = int(pos.x);
+	int mapY0 = int(pos.y);
+
+	__m256 zero = _mm256_setzero_ps();
+
+	// ray directions for the eight columns
+	__m256 rayDirX = _mm256_loadu_ps(table.GetRayDirX() + x);
+	__m256 rayDirY = _mm256_loadu_ps(table.GetRayDirY() + x);
+	__m256 deltaDistX = _mm256_loadu_ps(table.GetDeltaDistX() + x);
+	__m256 deltaDistY = _mm256_loadu_ps(table.GetDeltaDistY() + x);
+	__m256 maxDist = _mm256_loadu_ps(table.GetMaxDist() + x);
+
+	// step is -1 (all bits set) for negative directions, 1 otherwise
+	__m256 negX = _mm256_cmp_ps(rayDirX, zero, _CMP_LT_OQ);
+	__m256 negY = _mm256_cmp_ps(rayDirY, zero, _CMP_LT_OQ);
+	__m256i stepX = _mm256_or_si256(_mm256_castps_si256(negX), _mm256_set1_epi32(1));
+	__m256i stepY = _mm256_or_si256(_mm256_castps_si256(negY), _mm256_set1_epi32(1));
+
+	__m256 startDistX = _mm256_blendv_ps(_mm256_mul_ps(_mm256_set1_ps(mapX0 + 1.0f - pos.x), deltaDistX), _mm256_mul_ps(_mm256_set1_ps(pos.x - mapX0), deltaDistX), negX);
+	__m256 startDistY = _mm256_blendv_ps(_mm256_mul_ps(_mm256_set1_ps(mapY0 + 1.0f - pos.y), deltaDistY), _mm256_mul_ps(_mm256_set1_ps(pos.y - mapY0), deltaDistY), negY);
+	__m256 sideDistX = startDistX;
+	__m256 sideDistY = startDistY;
+
+	__m256i mapX = _mm256_set1_epi32(mapX0);
+	__m256i mapY = _mm256_set1_epi32(mapY0);
+	__m256i width = _mm256_set1_epi32(map.GetWidth());
+	__m256i height = _mm256_set1_epi32(map.GetHeight());
+	__m256i stride = _mm256_set1_epi32(map.GetFieldStride());
+	__m256i minusOne = _mm256_set1_epi32(-1);
+	__m256i zeroi = _mm256_setzero_si256();
+	__m256i leapMin = _mm256_set1_epi32(LEAP_MIN_RADIUS);
+	__m256i byte = _mm256_set1_epi32(0xFF);
+
+	__m256i stepsX = zeroi;
+	__m256i stepsY = zeroi;
+	__m256i dist = _mm256_set1_epi32(field[mapY0*map.GetFieldStride() + mapX0]);
+
+	__m256i active = minusOne;
+	__m256i side = zeroi;
+	__m256i hit = zeroi;
+
+	PacketLanes lanes;
+
+	while (_mm256_movemask_epi8(active)) {
+		// rays in wide empty squares leap across them, a lane at a time
+		__m256i leap = _mm256_and_si256(_mm256_cmpgt_epi32(dist, leapMin), active);
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(leap));
+
+		if (mask) {
+			_mm256_store_ps(lanes.sideDistX, sideDistX);
+			_mm256_store_ps(lanes.sideDistY, sideDistY);
+			_mm256_store_ps(lanes.startDistX, startDistX);
+			_mm256_store_ps(lanes.startDistY, startDistY);
+			_mm256_store_ps(lanes.deltaDistX, deltaDistX);
+			_mm256_store_ps(lanes.deltaDistY, deltaDistY);
+			_mm256_store_si256((__m256i *)lanes.mapX, mapX);
+			_mm256_store_si256((__m256i *)lanes.mapY, mapY);
+			_mm256_store_si256((__m256i *)lanes.stepX, stepX);
+			_mm256_store_si256((__m256i *)lanes.stepY, stepY);
+			_mm256_store_si256((__m256i *)lanes.stepsX, stepsX);
+			_mm256_store_si256((__m256i *)lanes.stepsY, stepsY);
+			_mm256_store_si256((__m256i *)lanes.dist, dist);
+
+			LeapLanes(map, lanes, mask);
+
+			sideDistX = _mm256_load_ps(lanes.sideDistX);
+			sideDistY = _mm256_load_ps(lanes.sideDistY);
+			mapX = _mm256_load_si256((const __m256i *)lanes.mapX);
+			mapY = _mm256_load_si256((const __m256i *)lanes.mapY);
+			stepsX = _mm256_load_si256((const __m256i *)lanes.stepsX);
+			stepsY = _mm256_load_si256((const __m256i *)lanes.stepsY);
+		}
+
+		// rays reaching the fog are done
+		__m256 fog = _mm256_cmp_ps(_mm256_min_ps(sideDistX, sideDistY), maxDist, _CMP_GE_OQ);
+		active = _mm256_andnot_si256(_mm256_castps_si256(fog), active);
+
+		// jump to next map square, OR in x-direction, OR in y-direction
+		__m256i xside = _mm256_castps_si256(_mm256_cmp_ps(sideDistX, sideDistY, _CMP_LT_OQ));
+		__m256i mx = _mm256_and_si256(xside, active);
+		__m256i my = _mm256_andnot_si256(xside, active);
+
+		stepsX = _mm256_sub_epi32(stepsX, mx);
+		stepsY = _mm256_sub_epi32(stepsY, my);
+		sideDistX = _mm256_add_ps(startDistX, _mm256_mul_ps(_mm256_cvtepi32_ps(stepsX), deltaDistX));
+		sideDistY = _mm256_add_ps(startDistY, _mm256_mul_ps(_mm256_cvtepi32_ps(stepsY), deltaDistY));
+		mapX = _mm256_add_epi32(mapX, _mm256_and_si256(stepX, mx));
+		mapY = _mm256_add_epi32(mapY, _mm256_and_si256(stepY, my));
+		side = _mm256_blendv_epi8(side, my, active);
+
+		// gather the distances of the rays still going, a byte each
+		__m256i idx = _mm256_add_epi32(_mm256_mullo_epi32(mapY, stride), mapX);
+		dist = _mm256_and_si256(_mm256_mask_i32gather_epi32(zeroi, (const int *)field, idx, active, 1), byte);
+		__m256i wall = _mm256_and_si256(_mm256_cmpeq_epi32(dist, zeroi), active);
+
+		// the border reads as a wall too, rays that reach it have left the map
+		if (_mm256_movemask_epi8(wall)) {
+			__m256i inside = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(mapX, minusOne), _mm256_cmpgt_epi32(width, mapX)),
+				_mm256_and_si256(_mm256_cmpgt_epi32(mapY, minusOne), _mm256_cmpgt_epi32(height, mapY)));
+
+			hit = _mm256_or_si256(hit, _mm256_and_si256(wall, inside));
+			active = _mm256_andnot_si256(wall, active);
+		}
+	}
+
+	alignas(32) float fs[9][8];
+	alignas(32) int is[8][8];
+	_mm256_store_ps(fs[0], rayDirX);
+	_mm256_store_ps(fs[1], rayDirY);
+	_mm256_store_ps(fs[2], deltaDistX);
+	_mm256_store_ps(fs[3], deltaDistY);
+	_mm256_store_ps(fs[4], sideDistX);
+	_mm256_store_ps(fs[5], sideDistY);
+	_mm256_store_ps(fs[6], startDistX);
+	_mm256_store_ps(fs[7], startDistY);
+	_mm256_store_ps(fs[8], maxDist);
+	_mm256_store_si256((__m256i *)is[0], mapX);
+	_mm256_store_si256((__m256i *)is[1], mapY);
+	_mm256_store_si256((__m256i *)is[2], stepX);
+	_mm256_store_si256((__m256i *)is[3], stepY);
+	_mm256_store_si256((__m256i *)is[4], side);
+	_mm256_store_si256((__m256i *)is[5], hit);
+	_mm256_store_si256((__m256i *)is[6], stepsX);
+	_mm256_store_si256((__m256i *)is[7], stepsY);
+
+	for (int i=0; i<8; ++i) {
+		Ray &ray = rays[i];
+		ray.rayDirX = fs[0][i];
+		ray.rayDirY = fs[1][i];
+		ray.deltaDistX = fs[2][i];
+		ray.deltaDistY = fs[3][i];
+		ray.sideDistX = fs[4][i];
+		ray.sideDistY = fs[5][i];
+		ray.startDistX = fs[6][i];
+		ray.startDistY = fs[7][i];
+		ray.maxDist = fs[8][i];
+		ray.mapX = is[0][i];
+		ray.mapY = is[1][i];
+		ray.stepX = is[2][i];
+		ray.stepY = is[3][i];
+		ray.side = is[4][i] != 0;
+		ray.hit = is[5][i] != 0;
+		ray.stepsX = is[6][i];
+		ray.stepsY = is[7][i];
+	}
+}
+#endif
+
+void RayCaster::TracePacket(const Map &map, const RayTable &table, const Camera &cam, int x, Ray *rays) {
+#ifdef RAYCASTER_SIMD
+	// the packet paths read the distance field directly, from a camera on the map
+	if (map.GetData() && map.IsInside(int(cam.position.x), int(cam.position.y))) {
+		if (m_Mode == PacketMode::AVX2) {
+			TracePacketAVX2(map, table, cam, x, rays);
+			return;
+		} else if (m_Mode == PacketMode::SSE) {
+			TracePacketSSE(map, table, cam, x, rays);
+			return;
+		}
+	}
+#endif
+
+	for (int i=0; i<GetPacketWidth(); ++i) {
+		Setup(table, cam, x + i, rays[i]);
+		Trace(map, rays[i]);
+	}
+}
+
+int RayCaster::GetPacketWidth() {
+	switch (m_Mode) {
+		case PacketMode::AVX2:
+			return 8;
+		case PacketMode::SSE:
+			return 4;
+		default:
+			return 1;
+	}
+}
+
+void RayCaster::SetMode(PacketMode mode) {
+	PacketMode best = GetBestMode();
+	m_Mode = (int)mode < (int)best ? mode : best;
+}
+
+PacketMode RayCaster::GetMode() {
+	return m_Mode;
+}
+
+PacketMode RayCaster::GetBestMode() {
+#ifdef RAYCASTER_SIMD
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return PacketMode::AVX2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return PacketMode::SSE;
+#endif
+
+	return PacketMode::SCALAR;
+}
\ No newline at end of file
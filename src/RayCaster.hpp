@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+
+#include "Camera.hpp"
+#include "Map.hpp"
+
+#define MAX_PACKET_WIDTH 8
+
+// cell crossing length of a ray along an axis, finite so whole crossings can be multiplied out
+#define RAY_MAX_DELTA 1e30f
+
+// rays only leap across empty squares at least this far to their edge, nearer ones are stepped
+#define LEAP_MIN_RADIUS 2
+
+// the state of one ray walking the grid, enough to carry on stepping after a hit
+struct Ray {
+	float	rayDirX;
+	float	rayDirY;
+
+	// length of ray from one x or y-side to next x or y-side
+	float	deltaDistX;
+	float	deltaDistY;
+
+	// length of ray from current position to next x or y-side, always the first ones plus the
+	// sides crossed since, so leaping over many cells lands exactly where stepping would
+	float	sideDistX;
+	float	sideDistY;
+	float	startDistX;
+	float	startDistY;
+	int		stepsX;
+	int		stepsY;
+
+	// the ray stops short of this, the fog distance along it
+	float	maxDist;
+
+	// which box of the map we're in, and which way we step (either +1 or -1)
+	int		mapX;
+	int		mapY;
+	int		stepX;
+	int		stepY;
+
+	bool	side;	// EASTWEST = false
+	bool	hit;	// false once the ray has left the map or reached maxDist
+};
+
+// per-column camera rays, the camera-space part is rebuilt when the resolution or FOV changes
+// and the world-space directions are re-rotated only when the view basis changes
+class RayTable {
+public:
+	RayTable();
+
+	void Update(const Camera &cam, int screenWidth, float fogDistance);
+
+	int GetWidth() const;
+
+	const float *GetRayDirX() const;
+	const float *GetRayDirY() const;
+	const float *GetDeltaDistX() const;
+	const float *GetDeltaDistY() const;
+
+	// cos of the column's angle off the view direction, for the door inset
+	const float *GetDoorCos() const;
+
+	// how far along each ray the fog distance (straight ahead) is
+	const float *GetMaxDist() const;
+
+private:
+	int					m_Width;
+	float				m_FOV;
+	float				m_FogDistance;
+	sf::Vector2f		m_Forward;
+	sf::Vector2f		m_Right;
+
+	// camera space
+	std::vector<float>	m_CameraX;
+	std::vector<float>	m_Length;
+	std::vector<float>	m_DoorCos;
+
+	// world space
+	std::vector<float>	m_RayDirX;
+	std::vector<float>	m_RayDirY;
+	std::vector<float>	m_DeltaDistX;
+	std::vector<float>	m_DeltaDistY;
+	std::vector<float>	m_MaxDist;
+};
+
+enum class PacketMode {
+	SCALAR,
+	SSE,	// 4 rays, needs SSE4.1
+	AVX2,	// 8 rays
+};
+
+// DDA wall traversal, either a ray at a time or in packets of adjacent columns
+class RayCaster {
+public:
+	// set up the ray for screen column x
+	static void Setup(const RayTable &table, const Camera &cam, int x, Ray &ray);
+
+	// step a ray to the next wall, returns false if it left the map or reached its maxDist first.
+	// empty stretches are leapt over with the map's distance field
+	static bool Trace(const Map &map, Ray &ray);
+
+	// take every crossing before the ray leaves the empty square of radius r around its cell
+	static void Leap(Ray &ray, int r);
+
+	// if a ray that stopped without a hit did so in the fog rather than off the map
+	static bool InFog(const Map &map, const Ray &ray);
+
+	// set up and trace GetPacketWidth() adjacent columns starting at x, in lock-step
+	static void TracePacket(const Map &map, const RayTable &table, const Camera &cam, int x, Ray *rays);
+
+	static int GetPacketWidth();
+
+	// picks the widest mode this CPU supports that is no wider than the one asked for
+	static void SetMode(PacketMode mode);
+	static PacketMode GetMode();
+	static PacketMode GetBestMode();
+
+private:
+	static PacketMode	m_Mode;
+};
\ No newline at end of file
@@ -0,0 +1,1205 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Renderer.hpp"
+#include "ShadeTable.hpp"
+#include "Palette.hpp"
+
+#define BANDS_PER_THREAD 4
+
+// column states for incremental frames
+#define COLUMN_CLEAN 0
+#define COLUMN_DIRTY 1
+#define COLUMN_SPRITE 2
+
+// what differs between the packed pixel and the palette index pipelines
+template<typename Pixel>
+struct PixelFormat;
+
+template<>
+struct PixelFormat<sf::Uint32> {
+	static sf::Uint32 *GetFrame(FrameBuffer &fb) { return fb.GetPixels(); }
+	static const sf::Uint32 *GetColumn(const WallAtlas &atlas, int n, int u, int level) { return atlas.GetColumn(n, u, level); }
+	static const sf::Uint32 *GetColumn(const SpriteSheet &sheet, int x, int level) { return sheet.GetColumn(x, level); }
+	static sf::Uint32 GetColor(const sf::Color &c) { return PackColor(c); }
+	static sf::Uint32 Shade(sf::Uint32 texel, const sf::Uint8 *shade) { return ShadeTable::Apply(texel, shade); }
+
+	// shade a texel over what is already there, filtered mip levels leave partly transparent edges
+	static sf::Uint32 Blend(sf::Uint32 dst, sf::Uint32 texel, const sf::Uint8 *shade) {
+		sf::Uint8 alpha = ((const sf::Uint8 *)&texel)[3];
+		texel = ShadeTable::Apply(texel, shade);
+
+		if (alpha < 255) {
+			const sf::Uint8 *d = (const sf::Uint8 *)&dst;
+			sf::Uint8 *src = (sf::Uint8 *)&texel;
+
+			for (int c=0; c<3; ++c)
+				src[c] = sf::Uint8((src[c]*alpha + d[c]*(255 - alpha))/255);
+			src[3] = 255;
+		}
+
+		return texel;
+	}
+};
+
+template<>
+struct PixelFormat<sf::Uint8> {
+	static sf::Uint8 *GetFrame(FrameBuffer &fb) { return fb.GetIndices(); }
+	static const sf::Uint8 *GetColumn(const WallAtlas &atlas, int n, int u, int level) { return atlas.GetIndexColumn(n, u, level); }
+	static const sf::Uint8 *GetColumn(const SpriteSheet &sheet, int x, int level) { return sheet.GetIndexColumn(x, level); }
+	static sf::Uint8 GetColor(const sf::Color &c) { return Palette::Match(PackColor(c)); }
+	static sf::Uint8 Shade(sf::Uint8 texel, const sf::Uint8 *colormap) { return colormap[texel]; }
+
+	// indices carry no alpha, every texel in a post is drawn as opaque
+	static sf::Uint8 Blend(sf::Uint8, sf::Uint8 texel, const sf::Uint8 *colormap) { return colormap[texel]; }
+};
+
+// one post of a sprite column. Blend for levels with partly transparent texels, and Clamp for
+// the post reaching the bottom of the frame, whose last texel row covers the rest of the sprite
+template<typename Pixel, bool Blend, bool Clamp>
+static void DrawPost(Pixel *column, int stride, const Pixel *strip, const sf::Uint8 *shade,
+	int y0, int y1, int v, int step, int lastRow)
+{
+	for (int y = y0; y < y1; y++, v += step) {
+		Pixel texel = strip[Clamp ? std::min(v >> 16, lastRow) : v >> 16];
+
+		if (Blend)
+			column[y*stride] = PixelFormat<Pixel>::Blend(column[y*stride], texel, shade);
+		else
+			column[y*stride] = PixelFormat<Pixel>::Shade(texel, shade);
+	}
+}
+
+static bool SameCamera(const Camera &a, const Camera &b) {
+	return a.position == b.position && a.forward == b.forward && a.right == b.right && a.fov == b.fov && a.height == b.height;
+}
+
+static ColumnHit NoHit() {
+	ColumnHit hit;
+	hit.cell = -1;
+	hit.face = WallSide::NORTH;
+	hit.position = sf::Vector2f(-1.f, -1.f);
+	hit.distance = std::numeric_limits<float>::max();
+	hit.u = 0.f;
+	hit.texture = 0;
+	hit.door = false;
+	hit.doorAmount = 0.f;
+
+	return hit;
+}
+
+static bool SameProjection(const ProjectedSprite &a, const ProjectedSprite &b) {
+	return a.sprite == b.sprite && a.sheet == b.sheet && a.level == b.level && a.rect == b.rect && a.screenX == b.screenX && a.width == b.width &&
+		a.xBegin == b.xBegin && a.xEnd == b.xEnd && a.top == b.top && a.height == b.height && a.depth == b.depth &&
+		a.depthTest == b.depthTest && a.shade == b.shade;
+}
+
+Renderer::Renderer(int width, int height)
+	: m_ThreadPool(nullptr), m_Palettized(false), m_WallMode(WallMode::DDA), m_DrawColumn(&Renderer::DrawColumn<true, 0>), m_FixedPoint(false), m_DrawFixedColumn(&Renderer::DrawFixedColumn<true, 0>), m_FogDistance(FOG_DISTANCE), m_RowDistHeight(0), m_RowDistEye(0.f), m_CulledSprites(0), m_SpriteCoverage(false), m_Incremental(true), m_HasFrame(false), m_FullFrame(true),
+	m_LastMap(nullptr), m_MapRevision(0), m_RedrawnColumns(0)
+{
+	SetSize(width, height);
+}
+
+void Renderer::SetSize(int width, int height) {
+	m_FrameBuffer.Create(width, height);
+	m_WallTop.assign(width, 0);
+	m_WallBottom.assign(width, 0);
+	m_Dirty.assign(width, COLUMN_DIRTY);
+	m_Hits.assign(width, NoHit());
+
+	if (m_SpriteCoverage)
+		m_Coverage.assign(width*height, 0);
+
+	m_HasFrame = false;
+}
+
+void Renderer::SetSpriteCoverage(bool coverage) {
+	m_SpriteCoverage = coverage;
+	m_Coverage.assign(coverage ? m_FrameBuffer.GetWidth()*m_FrameBuffer.GetHeight() : 0, 0);
+
+	m_HasFrame = false;
+}
+
+bool Renderer::HasSpriteCoverage() const {
+	return m_SpriteCoverage;
+}
+
+void Renderer::SetPalettized(bool palettized) {
+	// the textures have no indices to draw from without the palette
+	m_Palettized = palettized && Palette::IsEnabled();
+	m_HasFrame = false;
+}
+
+bool Renderer::IsPalettized() const {
+	return m_Palettized;
+}
+
+void Renderer::SetWallMode(WallMode mode) {
+	m_WallMode = mode;
+	m_HasFrame = false;
+}
+
+WallMode Renderer::GetWallMode() const {
+	return m_WallMode;
+}
+
+void Renderer::SetFixedPoint(bool fixedPoint) {
+	m_FixedPoint = fixedPoint;
+	m_HasFrame = false;
+}
+
+bool Renderer::IsFixedPoint() const {
+	return m_FixedPoint;
+}
+
+void Renderer::SetFogDistance(float fogDistance) {
+	m_FogDistance = std::max(1.f, std::min(FOG_MAX_DISTANCE, fogDistance));
+	m_HasFrame = false;
+}
+
+float Renderer::GetFogDistance() const {
+	return m_FogDistance;
+}
+
+const SegmentCaster &Renderer::GetSegmentCaster() const {
+	return m_Segments;
+}
+
+void Renderer::SetIncremental(bool incremental) {
+	m_Incremental = incremental;
+}
+
+bool Renderer::IsIncremental() const {
+	return m_Incremental;
+}
+
+void Renderer::SetThreadPool(ThreadPool *pool) {
+	m_ThreadPool = pool;
+}
+
+int Renderer::GetWidth() const {
+	return m_FrameBuffer.GetWidth();
+}
+
+int Renderer::GetHeight() const {
+	return m_FrameBuffer.GetHeight();
+}
+
+const FrameBuffer &Renderer::GetFrameBuffer() const {
+	return m_FrameBuffer;
+}
+
+const sf::Vector2f &Renderer::GetHitCoords() const {
+	return m_Hits[m_FrameBuffer.GetWidth()/2].position;
+}
+
+WallSide Renderer::GetHitSide() const {
+	return m_Hits[m_FrameBuffer.GetWidth()/2].face;
+}
+
+const ColumnHit &Renderer::GetColumnHit(int x) const {
+	return m_Hits[x];
+}
+
+Sprite *Renderer::GetSpriteAt(int x, int y) const {
+	if (!m_SpriteCoverage)
+		return nullptr;
+
+	int label = m_Coverage[y*m_FrameBuffer.GetWidth() + x];
+	return label ? m_Projected[label - 1].sprite : nullptr;
+}
+
+void Renderer::GetDepthImage(std::vector<float> &depth) const {
+	int w = m_FrameBuffer.GetWidth();
+	int h = m_FrameBuffer.GetHeight();
+	float eye = m_LastCamera.height;
+
+	depth.resize(w*h);
+
+	for (int y = 0; y < h; y++) {
+		// the floor and ceiling planes through the centre of the row
+		float flat = y < h/2 ? h*(1.f - eye)/(h/2 - y - 0.5f) : h*eye/(y + 0.5f - h/2);
+
+		for (int x = 0; x < w; x++) {
+			int label = m_SpriteCoverage ? m_Coverage[y*w + x] : 0;
+
+			if (label)
+				depth[y*w + x] = m_Projected[label - 1].depth;
+			else if (y >= m_WallTop[x] && y < m_WallBottom[x])
+				depth[y*w + x] = m_Hits[x].distance;
+			else
+				depth[y*w + x] = flat;
+		}
+	}
+}
+
+void Renderer::GetObjectImage(std::vector<sf::Uint32> &ids) const {
+	int w = m_FrameBuffer.GetWidth();
+	int h = m_FrameBuffer.GetHeight();
+
+	ids.resize(w*h);
+
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			int label = m_SpriteCoverage ? m_Coverage[y*w + x] : 0;
+
+			if (label)
+				ids[y*w + x] = MakeObjectId(ObjectKind::SPRITE, m_Projected[label - 1].index);
+			else if (y < m_WallTop[x])
+				ids[y*w + x] = MakeObjectId(ObjectKind::CEILING, 0);
+			else if (y < m_WallBottom[x])
+				ids[y*w + x] = MakeObjectId(ObjectKind::WALL, m_Hits[x].cell);
+			else
+				ids[y*w + x] = MakeObjectId(ObjectKind::FLOOR, 0);
+		}
+	}
+}
+
+int Renderer::GetCulledSprites() const {
+	return m_CulledSprites;
+}
+
+int Renderer::GetRedrawnColumns() const {
+	return m_RedrawnColumns;
+}
+
+void Renderer::Render(const Map &map, const Camera &cam) {
+	int w = m_FrameBuffer.GetWidth();
+	int h = m_FrameBuffer.GetHeight();
+
+	// only touches the per-column rays if the view turned or the resolution changed
+	if (m_FixedPoint)
+		m_FixedTable.Update(cam, w, m_FogDistance);
+	else
+		m_RayTable.Update(cam, w, m_FogDistance);
+	SelectKernels(map);
+
+	// anything but map changes under an unchanged camera needs the whole frame
+	bool full = !m_Incremental || !m_HasFrame || &map != m_LastMap || !SameCamera(cam, m_LastCamera);
+
+	m_ChangedCells.clear();
+	if (!full)
+		full = !map.GetChangedCells(m_MapRevision, m_ChangedCells);
+
+	// the faces in view, for whichever columns get cast below
+	if (m_WallMode == WallMode::SEGMENTS && !m_FixedPoint)
+		m_Segments.Cast(map, m_RayTable, cam, m_FogDistance);
+
+	m_HasFrame = true;
+	m_FullFrame = full;
+	m_LastMap = &map;
+	m_MapRevision = map.GetRevision();
+	m_LastCamera = cam;
+
+	if (!full) {
+		std::fill(m_Dirty.begin(), m_Dirty.end(), COLUMN_CLEAN);
+		for (int p : m_ChangedCells)
+			MarkCell(map, cam, p);
+
+		m_RedrawnColumns = RedrawMarked(map, cam, COLUMN_DIRTY);
+		return;
+	}
+
+	std::fill(m_Dirty.begin(), m_Dirty.end(), COLUMN_DIRTY);
+	m_RedrawnColumns = w;
+
+	// incremental frames share the camera, so they share the rows too
+	UpdateRows(map, cam);
+
+	// the wall pass writes every depth value and column hit, and the background pass the pixels
+	// the walls did not cover, so there is no clear
+	if (!m_ThreadPool) {
+		CastWalls(map, cam, 0, w);
+
+		if (m_Palettized)
+			FillBackground<sf::Uint8>(map, 0, h);
+		else
+			FillBackground<sf::Uint32>(map, 0, h);
+		return;
+	}
+
+	int bands = m_ThreadPool->GetThreadCount()*BANDS_PER_THREAD;
+
+	m_ThreadPool->ParallelFor(w, bands, [&](int begin, int end) {
+		CastWalls(map, cam, begin, end);
+	});
+
+	m_ThreadPool->ParallelFor(h, bands, [&](int begin, int end) {
+		if (m_Palettized)
+			FillBackground<sf::Uint8>(map, begin, end);
+		else
+			FillBackground<sf::Uint32>(map, begin, end);
+	});
+}
+
+void Renderer::MarkCell(const Map &map, const Camera &cam, int p) {
+	int w = m_FrameBuffer.GetWidth();
+
+	// a cell the camera's cell cannot see changes nothing on screen
+	int camX = (int)std::floor(cam.position.x);
+	int camY = (int)std::floor(cam.position.y);
+	if (map.IsInside(camX, camY) && !map.CanSee(camY*map.GetWidth() + camX, p))
+		return;
+
+	const sf::Vector2f &look = cam.forward;
+	const sf::Vector2f &right = cam.right;
+	float invDet = 1.0f / (right.x * look.y - look.x * right.y);
+
+	float left = std::numeric_limits<float>::max();
+	float rightmost = -std::numeric_limits<float>::max();
+	int behind = 0;
+
+	// project the cell's corners, the columns between them are the only ones that can see it
+	for (int i=0; i<4; ++i) {
+		float cornerX = p%map.GetWidth() + (i & 1) - cam.position.x;
+		float cornerY = p/map.GetWidth() + (i >> 1) - cam.position.y;
+
+		float transformX = invDet * (look.y * cornerX - look.x * cornerY);
+		float transformY = invDet * (-right.y * cornerX + right.x * cornerY);
+
+		if (transformY <= 0.f) {
+			behind++;
+			continue;
+		}
+
+		float screenX = (w / 2) * (1 + transformX / transformY);
+		left = std::min(left, screenX);
+		rightmost = std::max(rightmost, screenX);
+	}
+
+	// wholly behind the camera, no ray reaches it
+	if (behind == 4)
+		return;
+
+	// straddling the camera plane, play safe
+	int xBegin = 0;
+	int xEnd = w;
+
+	if (behind == 0) {
+		xBegin = std::max(0, int(std::floor(left)) - 1);
+		xEnd = std::min(w, int(std::ceil(rightmost)) + 2);
+	}
+
+	for (int x = xBegin; x < xEnd; x++)
+		m_Dirty[x] = COLUMN_DIRTY;
+}
+
+int Renderer::RedrawMarked(const Map &map, const Camera &cam, sf::Uint8 mark) {
+	int w = m_FrameBuffer.GetWidth();
+	int count = (int)std::count(m_Dirty.begin(), m_Dirty.end(), mark);
+
+	if (count == 0)
+		return 0;
+
+	if (!m_ThreadPool) {
+		RedrawColumns(map, cam, 0, w, mark);
+		return count;
+	}
+
+	int bands = m_ThreadPool->GetThreadCount()*BANDS_PER_THREAD;
+
+	m_ThreadPool->ParallelFor(w, bands, [&](int begin, int end) {
+		RedrawColumns(map, cam, begin, end, mark);
+	});
+
+	return count;
+}
+
+void Renderer::RedrawColumns(const Map &map, const Camera &cam, int xBegin, int xEnd, sf::Uint8 mark) {
+	// runs of neighbouring columns still go through the ray packets
+	int x = xBegin;
+	while (x < xEnd) {
+		if (m_Dirty[x] != mark) {
+			x++;
+			continue;
+		}
+
+		int end = x;
+		while (end < xEnd && m_Dirty[end] == mark)
+			end++;
+
+		CastWalls(map, cam, x, end);
+
+		if (m_Palettized)
+			FillColumns<sf::Uint8>(map, x, end);
+		else
+			FillColumns<sf::Uint32>(map, x, end);
+
+		x = end;
+	}
+}
+
+template<typename Pixel>
+void Renderer::FillColumns(const Map &map, int xBegin, int xEnd) {
+	int w = m_FrameBuffer.GetWidth();
+	int h = m_FrameBuffer.GetHeight();
+	Pixel *pixels = PixelFormat<Pixel>::GetFrame(m_FrameBuffer);
+
+	const WallAtlas &atlas = map.GetWallAtlas();
+	int texWidth = atlas.GetTexWidth();
+	int texHeight = atlas.GetTexHeight();
+	int ceilingTex = std::min(map.GetCeilingTexture(), atlas.GetTextureCount());
+	int floorTex = std::min(map.GetFloorTexture(), atlas.GetTextureCount());
+
+	Pixel ceiling = PixelFormat<Pixel>::GetColor(map.GetCeilingColor());
+	Pixel floor = PixelFormat<Pixel>::GetColor(map.GetFloorColor());
+
+	// the same as FillBackground for a few columns, strided but only touching what changed
+	for (int x = xBegin; x < xEnd; x++) {
+		Pixel *column = pixels + x;
+
+		for (int y = 0; y < m_WallTop[x]; y++)
+			column[y*w] = ceilingTex > 0 ? FlatCaster::Sample(m_Rows[y], PixelFormat<Pixel>::GetColumn(atlas, ceilingTex - 1, 0, 0), texWidth, texHeight, x) : ceiling;
+		for (int y = m_WallBottom[x]; y < h; y++)
+			column[y*w] = floorTex > 0 ? FlatCaster::Sample(m_Rows[y], PixelFormat<Pixel>::GetColumn(atlas, floorTex - 1, 0, 0), texWidth, texHeight, x) : floor;
+	}
+}
+
+void Renderer::DrawSprites(const std::vector<Sprite *> &sprites, const Camera &cam) {
+	int w = m_FrameBuffer.GetWidth();
+	int h = m_FrameBuffer.GetHeight();
+
+	const sf::Vector2f &pos = cam.position;
+	const sf::Vector2f &look = cam.forward;
+	const sf::Vector2f &right = cam.right;
+
+	float invDet = 1.0f / (right.x * look.y - look.x * right.y);
+
+	// project every sprite once, distance, mip level and shade are per sprite not per column
+	m_Projected.clear();
+	m_CulledSprites = 0;
+
+	// span queries against the walls, so hidden sprites never reach the column loop
+	if (!sprites.empty())
+		m_DepthHierarchy.Build(m_FrameBuffer.GetDepthBuffer(), w);
+
+	// and sprites in cells the camera's cell cannot see are dropped before projecting
+	int camX = (int)std::floor(pos.x);
+	int camY = (int)std::floor(pos.y);
+	bool visibleSet = m_LastMap && m_LastMap->IsInside(camX, camY);
+
+	for (size_t i=0; i<sprites.size(); ++i) {
+		Sprite *sprite = sprites[i];
+		float spriteX = sprite->GetPosition().x - pos.x;
+		float spriteY = sprite->GetPosition().y - pos.y;
+
+		if (look.x*spriteX + look.y*spriteY <= 0)
+			continue;
+
+		const SpriteSheet *sheet = sprite->GetSpriteSheet();
+		const sf::Vector2u &size = sheet->GetFrameSize();
+
+		// the set reaches a cell around what is seen, enough for a billboard up to two cells wide
+		if (visibleSet && sprite->GetScale()*size.x <= 2.f*size.y) {
+			int cellX = (int)std::floor(sprite->GetPosition().x);
+			int cellY = (int)std::floor(sprite->GetPosition().y);
+
+			if (m_LastMap->IsInside(cellX, cellY) && !m_LastMap->CanSee(camY*m_LastMap->GetWidth() + camX, cellY*m_LastMap->GetWidth() + cellX)) {
+				m_CulledSprites++;
+				continue;
+			}
+		}
+
+		float transformX = invDet * (look.y * spriteX - look.x * spriteY);
+		float transformY = invDet * (-right.y * spriteX + right.x * spriteY);
+
+		if (transformY <= 0)
+			continue;
+
+		float height = (float)std::abs(int(h / transformY));
+		int spriteScreenX = int((w / 2) * (1 + transformX / transformY));
+		int spriteScreenY = int(h/2 + height*(cam.height - sprite->GetScale()/2.f - (1.f - sprite->GetScale())*sprite->GetFloatHeight()));
+		height *= sprite->GetScale();
+
+		ProjectedSprite p;
+		p.width = int(size.x*(height/size.y));
+		p.screenX = -p.width/2 + spriteScreenX;
+		p.xBegin = std::max(0, p.screenX);
+		p.xEnd = std::min(w, p.width/2 + spriteScreenX);
+
+		if (p.width <= 0 || p.xBegin >= p.xEnd)
+			continue;
+
+		if (m_DepthHierarchy.GetMax(p.xBegin, p.xEnd) <= transformY) {
+			m_CulledSprites++;
+			continue;
+		}
+
+		p.depthTest = m_DepthHierarchy.GetMin(p.xBegin, p.xEnd) <= transformY;
+		p.sprite = sprite;
+		p.index = (int)i;
+		p.sheet = sheet;
+		p.level = sheet->SelectLevel(height);
+		p.translucent = sheet->IsTranslucent(p.level);
+		p.rect = sprite->GetTextureRect(p.level, cam.position);
+		p.top = spriteScreenY - height/2.f;
+		p.height = height;
+		p.depth = transformY;
+
+		// darken based on distance
+		float dist = std::sqrt(spriteX*spriteX + spriteY*spriteY);
+		int mod = int(255.f*std::max(0.f, 1.f - dist/m_FogDistance));
+		p.shade = m_Palettized ? Palette::GetColormap(mod, false) : ShadeTable::Get(mod, false);
+
+		m_Projected.push_back(p);
+	}
+
+	// on an incremental frame, if any sprite moved or changed, the columns under where it
+	// was and where it is now need their walls back before the sprites go over them
+	bool same = m_Projected.size() == m_LastProjected.size();
+	for (size_t i=0; same && i<m_Projected.size(); ++i)
+		same = SameProjection(m_Projected[i], m_LastProjected[i]);
+
+	if (!m_FullFrame && !same) {
+		for (const std::vector<ProjectedSprite> *list : { &m_LastProjected, &m_Projected })
+			for (const ProjectedSprite &p : *list)
+				for (int x = p.xBegin; x < p.xEnd; x++)
+					if (m_Dirty[x] == COLUMN_CLEAN)
+						m_Dirty[x] = COLUMN_SPRITE;
+
+		m_RedrawnColumns += RedrawMarked(*m_LastMap, cam, COLUMN_SPRITE);
+	}
+
+	m_LastProjected = m_Projected;
+
+	if (!m_ThreadPool) {
+		if (m_SpriteCoverage)
+			ClearCoverage(0, h);
+
+		if (!m_Palettized)
+			CompositeSprites<sf::Uint32>(0, w);
+		else {
+			CompositeSprites<sf::Uint8>(0, w);
+			Palette::Resolve(m_FrameBuffer.GetIndices(), m_FrameBuffer.GetPixels(), w*h);
+		}
+		return;
+	}
+
+	int bands = m_ThreadPool->GetThreadCount()*BANDS_PER_THREAD;
+
+	if (m_SpriteCoverage) {
+		m_ThreadPool->ParallelFor(h, bands, [&](int begin, int end) {
+			ClearCoverage(begin, end);
+		});
+	}
+
+	if (!m_Projected.empty()) {
+		m_ThreadPool->ParallelFor(w, bands, [&](int begin, int end) {
+			if (m_Palettized)
+				CompositeSprites<sf::Uint8>(begin, end);
+			else
+				CompositeSprites<sf::Uint32>(begin, end);
+		});
+	}
+
+	// the only pass over the frame in packed pixels
+	if (m_Palettized) {
+		m_ThreadPool->ParallelFor(h, bands, [&](int begin, int end) {
+			Palette::Resolve(m_FrameBuffer.GetIndices() + begin*w, m_FrameBuffer.GetPixels() + begin*w, (end - begin)*w);
+		});
+	}
+}
+
+void Renderer::ClearCoverage(int yBegin, int yEnd) {
+	int w = m_FrameBuffer.GetWidth();
+
+	// the columns drawn again this frame start with no sprites
+	for (int y = yBegin; y < yEnd; y++)
+		for (int x = 0; x < w; x++)
+			if (m_Dirty[x] != COLUMN_CLEAN)
+				m_Coverage[y*w + x] = 0;
+}
+
+template<typename Pixel>
+void Renderer::CompositeSprites(int xBegin, int xEnd) {
+	int screenWidth = m_FrameBuffer.GetWidth();
+	int screenHeight = m_FrameBuffer.GetHeight();
+	Pixel *pixels = PixelFormat<Pixel>::GetFrame(m_FrameBuffer);
+	const float *depthBuffer = m_FrameBuffer.GetDepthBuffer();
+	sf::Uint32 *coverage = m_SpriteCoverage ? m_Coverage.data() : nullptr;
+
+	// every band walks the sprites back to front over its own columns
+	for (size_t n=0; n<m_Projected.size(); ++n) {
+		const ProjectedSprite &p = m_Projected[n];
+		int yBegin = std::max(0, int(std::ceil(p.top - 0.5f)));
+		int yEnd = std::min(screenHeight, int(std::ceil(p.top + p.height - 0.5f)));
+
+		// texel rows in 16.16 fixed point
+		int step = std::max(1, int(p.rect.height*65536.f/p.height));
+		int start = int((yBegin + 0.5f - p.top)*p.rect.height*65536.f/p.height);
+		int row = p.rect.top/p.rect.height;
+
+		typedef void (*PostKernel)(Pixel *, int, const Pixel *, const sf::Uint8 *, int, int, int, int, int);
+		PostKernel post = p.translucent ? &DrawPost<Pixel, true, false> : &DrawPost<Pixel, false, false>;
+		PostKernel bottomPost = p.translucent ? &DrawPost<Pixel, true, true> : &DrawPost<Pixel, false, true>;
+
+		for (int x = std::max(xBegin, p.xBegin); x < std::min(xEnd, p.xEnd); x++) {
+			// columns that were not redrawn still hold these sprites from the last frame
+			if (m_Dirty[x] == COLUMN_CLEAN || (p.depthTest && depthBuffer[x] <= p.depth))
+				continue;
+
+			int texX = p.rect.left + (x - p.screenX)*p.rect.width/p.width;
+			const Pixel *strip = PixelFormat<Pixel>::GetColumn(*p.sheet, texX, p.level) + p.rect.top;
+			const SpritePost *posts = p.sheet->GetPosts(texX, row, p.level);
+			int count = p.sheet->GetPostCount(texX, row, p.level);
+			Pixel *column = pixels + x;
+
+			// only the opaque runs are walked, the rows between them are skipped outright
+			for (int i=0; i<count; ++i) {
+				int first = posts[i].top << 16;
+				int last = (posts[i].top + posts[i].length) << 16;
+
+				// the screen rows whose texel row lands in the post, the bottom row is clamped
+				// into the frame so a post reaching it runs to the end of the sprite
+				int y0 = yBegin + std::max(0, (first - start + step - 1)/step);
+				int v = start + (y0 - yBegin)*step;
+
+				int y1 = yEnd;
+				if (posts[i].top + posts[i].length < p.rect.height) {
+					y1 = std::min(yEnd, yBegin + std::max(0, (last - start + step - 1)/step));
+					post(column, screenWidth, strip, p.shade, y0, y1, v, step, p.rect.height - 1);
+				} else
+					bottomPost(column, screenWidth, strip, p.shade, y0, y1, v, step, p.rect.height - 1);
+
+				if (coverage)
+					for (int y = y0; y < y1; y++)
+						coverage[y*screenWidth + x] = (sf::Uint32)(n + 1);
+			}
+		}
+	}
+}
+
+void Renderer::UpdateRows(const Map &map, const Camera &cam) {
+	if (!map.GetFloorTexture() && !map.GetCeilingTexture())
+		return;
+
+	int w = m_FrameBuffer.GetWidth();
+	int h = m_FrameBuffer.GetHeight();
+
+	const WallAtlas &atlas = map.GetWallAtlas();
+	double texWidth = atlas.GetTexWidth()*65536.0;
+	double texHeight = atlas.GetTexHeight()*65536.0;
+
+	// the straight ahead distance to the floor (or ceiling) seen through the centre of each row
+	if (h != m_RowDistHeight || cam.height != m_RowDistEye) {
+		m_RowDist.resize(h);
+		m_RowDistHeight = h;
+		m_RowDistEye = cam.height;
+
+		for (int y = 0; y < h; y++) {
+			if (y < h/2)
+				m_RowDist[y] = h*(1.f - cam.height)/(h/2 - y - 0.5f);
+			else
+				m_RowDist[y] = h*cam.height/(y + 0.5f - h/2);
+		}
+	}
+
+	m_Rows.resize(h);
+
+	// walk each row from the left edge of the view to the right edge, texture coordinates only
+	// need the fraction of the cell so they fit the fixed point whatever the distance
+	for (int y = 0; y < h; y++) {
+		double d = m_RowDist[y];
+
+		double leftX = cam.position.x + d*(cam.forward.x - cam.right.x);
+		double leftY = cam.position.y + d*(cam.forward.y - cam.right.y);
+
+		FlatRow &row = m_Rows[y];
+		row.u = (sf::Uint32)((leftX - std::floor(leftX))*texWidth);
+		row.v = (sf::Uint32)((leftY - std::floor(leftY))*texHeight);
+		row.du = (sf::Uint32)(sf::Int64)(d*2.0*cam.right.x/w*texWidth);
+		row.dv = (sf::Uint32)(sf::Int64)(d*2.0*cam.right.y/w*texHeight);
+
+		// make distant floor darker, the same as the walls
+		row.mod = int(255.f*std::max(0.f, 1.f - (float)d/m_FogDistance));
+	}
+}
+
+template<typename Pixel>
+void Renderer::FillBackground(const Map &map, int yBegin, int yEnd) {
+	int w = m_FrameBuffer.GetWidth();
+	int h = m_FrameBuffer.GetHeight();
+	Pixel *pixels = PixelFormat<Pixel>::GetFrame(m_FrameBuffer);
+
+	const WallAtlas &atlas = map.GetWallAtlas();
+	int texWidth = atlas.GetTexWidth();
+	int texHeight = atlas.GetTexHeight();
+	int ceilingTex = std::min(map.GetCeilingTexture(), atlas.GetTextureCount());
+	int floorTex = std::min(map.GetFloorTexture(), atlas.GetTextureCount());
+
+	Pixel ceiling = PixelFormat<Pixel>::GetColor(map.GetCeilingColor());
+	Pixel floor = PixelFormat<Pixel>::GetColor(map.GetFloorColor());
+
+	// fill row by row so the writes stay contiguous, only touching pixels the walls left uncovered
+	for (int y = yBegin; y < std::min(yEnd, h/2); y++) {
+		Pixel *row = pixels + y*w;
+
+		if (ceilingTex > 0) {
+			FlatCaster::DrawSpan(m_Rows[y], PixelFormat<Pixel>::GetColumn(atlas, ceilingTex - 1, 0, 0), texWidth, texHeight, m_WallTop.data(), false, y, row, 0, w);
+			continue;
+		}
+
+		for (int x = 0; x < w; x++)
+			row[x] = y < m_WallTop[x] ? ceiling : row[x];
+	}
+
+	for (int y = std::max(yBegin, h/2); y < yEnd; y++) {
+		Pixel *row = pixels + y*w;
+
+		if (floorTex > 0) {
+			FlatCaster::DrawSpan(m_Rows[y], PixelFormat<Pixel>::GetColumn(atlas, floorTex - 1, 0, 0), texWidth, texHeight, m_WallBottom.data(), true, y, row, 0, w);
+			continue;
+		}
+
+		for (int x = 0; x < w; x++)
+			row[x] = y >= m_WallBottom[x] ? floor : row[x];
+	}
+}
+
+void Renderer::CastWalls(const Map &map, const Camera &cam, int xBegin, int xEnd) {
+	int width = RayCaster::GetPacketWidth();
+
+	// the same packets and tail in fixed point
+	if (m_FixedPoint) {
+		FixedRay rays[MAX_PACKET_WIDTH];
+
+		int x = xBegin;
+		for (; x + width <= xEnd; x += width) {
+			FixedCaster::TracePacket(map, m_FixedTable, cam, x, rays);
+
+			for (int i=0; i<width; ++i)
+				(this->*m_DrawFixedColumn)(map, cam, x + i, rays[i]);
+		}
+
+		for (; x < xEnd; x++) {
+			FixedCaster::Setup(m_FixedTable, cam, x, rays[0]);
+			FixedCaster::Trace(map, rays[0]);
+
+			(this->*m_DrawFixedColumn)(map, cam, x, rays[0]);
+		}
+
+		return;
+	}
+
+	Ray rays[MAX_PACKET_WIDTH];
+
+	// the face each column sees is already known, only doors and misses are traced
+	if (m_WallMode == WallMode::SEGMENTS) {
+		for (int x = xBegin; x < xEnd; x++) {
+			if (!m_Segments.GetRay(m_RayTable, x, rays[0])) {
+				RayCaster::Setup(m_RayTable, cam, x, rays[0]);
+				RayCaster::Trace(map, rays[0]);
+			}
+
+			(this->*m_DrawColumn)(map, cam, x, rays[0]);
+		}
+
+		return;
+	}
+
+	// DDA ray casting (WALL CASTING), whole packets of adjacent columns first
+	int x = xBegin;
+	for (; x + width <= xEnd; x += width) {
+		RayCaster::TracePacket(map, m_RayTable, cam, x, rays);
+
+		for (int i=0; i<width; ++i)
+			(this->*m_DrawColumn)(map, cam, x + i, rays[i]);
+	}
+
+	// then whatever is left of the band one ray at a time
+	for (; x < xEnd; x++) {
+		RayCaster::Setup(m_RayTable, cam, x, rays[0]);
+		RayCaster::Trace(map, rays[0]);
+
+		(this->*m_DrawColumn)(map, cam, x, rays[0]);
+	}
+}
+
+void Renderer::SelectKernels(const Map &map) {
+	int w = map.GetTexWidth();
+	int h = map.GetTexHeight();
+
+	int bits = 0;
+	if (w == h && w >= 32 && w <= 256 && (w & (w - 1)) == 0)
+		while ((1 << bits) < w)
+			bits++;
+
+	bool doors = map.HasDoors();
+
+	switch (bits) {
+		case 5:
+			m_DrawColumn = doors ? &Renderer::DrawColumn<true, 5> : &Renderer::DrawColumn<false, 5>;
+			m_DrawFixedColumn = doors ? &Renderer::DrawFixedColumn<true, 5> : &Renderer::DrawFixedColumn<false, 5>;
+			break;
+		case 6:
+			m_DrawColumn = doors ? &Renderer::DrawColumn<true, 6> : &Renderer::DrawColumn<false, 6>;
+			m_DrawFixedColumn = doors ? &Renderer::DrawFixedColumn<true, 6> : &Renderer::DrawFixedColumn<false, 6>;
+			break;
+		case 7:
+			m_DrawColumn = doors ? &Renderer::DrawColumn<true, 7> : &Renderer::DrawColumn<false, 7>;
+			m_DrawFixedColumn = doors ? &Renderer::DrawFixedColumn<true, 7> : &Renderer::DrawFixedColumn<false, 7>;
+			break;
+		case 8:
+			m_DrawColumn = doors ? &Renderer::DrawColumn<true, 8> : &Renderer::DrawColumn<false, 8>;
+			m_DrawFixedColumn = doors ? &Renderer::DrawFixedColumn<true, 8> : &Renderer::DrawFixedColumn<false, 8>;
+			break;
+		default:
+			m_DrawColumn = doors ? &Renderer::DrawColumn<true, 0> : &Renderer::DrawColumn<false, 0>;
+			m_DrawFixedColumn = doors ? &Renderer::DrawFixedColumn<true, 0> : &Renderer::DrawFixedColumn<false, 0>;
+	}
+}
+
+template<bool Doors, int TexBits>
+void Renderer::DrawColumn(const Map &map, const Camera &cam, int x, Ray &ray) {
+	// wall textures, the size is a constant in the specialised kernels
+	const WallAtlas &atlas = map.GetWallAtlas();
+	const int texWidth = TexBits ? 1 << TexBits : atlas.GetTexWidth();
+
+	const sf::Vector2f &pos = cam.position;
+
+	float rayDirX = ray.rayDirX;
+	float rayDirY = ray.rayDirY;
+	int stepX = ray.stepX;
+	int stepY = ray.stepY;
+
+	bool hit = ray.hit;
+	bool side = false;
+	bool door = false;
+	float doorAmount = 0.f;
+	WallSide cardinal = WallSide::NORTH;
+	float perpdist = 0.f;
+	float dist = 0.f;
+	sf::Vector2f hitpos;
+
+	// the ray has stopped on a wall, work out where, and carry on through open doors
+	while (hit) {
+		int mapX = ray.mapX;
+		int mapY = ray.mapY;
+		side = ray.side;
+
+		if (side)
+			cardinal = stepY < 0 ? WallSide::NORTH : WallSide::SOUTH;
+		else
+			cardinal = stepX < 0 ? WallSide::EAST : WallSide::WEST;
+
+		if (side) {
+			hitpos.x = pos.x + ((mapY - pos.y + (1 - stepY) / 2) / rayDirY) * rayDirX;
+			hitpos.y = (float)mapY;
+
+			perpdist = std::abs((mapY - pos.y + (1 - stepY) / 2) / rayDirY);
+		} else {
+			hitpos.y = pos.y + ((mapX - pos.x + (1 - stepX) / 2) / rayDirX) * rayDirY;
+			hitpos.x = (float)mapX;
+
+			perpdist = std::abs((mapX - pos.x + (1 - stepX) / 2) / rayDirX);
+		}
+
+		dist = std::sqrt(std::pow(hitpos.x - pos.x, 2.f) + std::pow(hitpos.y - pos.y, 2.f));
+
+		if (!Doors || !map.IsDoor(mapX, mapY))
+			break;
+
+		// the ray hit a door
+		if (map.IsOpen(mapX, mapY)) {
+			hit = RayCaster::Trace(map, ray);
+			continue;
+		}
+
+		// move ray on by inset
+		float inset = 0.5f;
+
+		float dhitposx = hitpos.x;
+		float dhitposy = hitpos.y;
+		int dmapX = mapX;
+		int dmapY = mapY;
+		float p;
+
+		if (side) {
+			float c = stepX*inset*std::abs(rayDirX/rayDirY);
+			p = std::sqrt(inset*inset + c*c);
+			dhitposx += c;
+
+			float amount;
+			if (map.IsMoving(mapX, mapY, amount) && dhitposx > (float)mapX) {
+				dhitposx += amount;
+			}
+
+			// flip the texture for back faces
+			if (stepY > 0)
+				dhitposx = (float)std::floor(mapX) + (1.f - (dhitposx - (float)std::floor(mapX)));
+
+			dmapX = (int)dhitposx;
+		} else {
+			float c = stepY*inset*std::abs(rayDirY/rayDirX);
+			p = std::sqrt(inset*inset + c*c);
+			dhitposy += c;
+
+			float amount;
+			if (map.IsMoving(mapX, mapY, amount) && dhitposy > (float)mapY) {
+				dhitposy += amount;
+			}
+
+			// flip the texture for back faces
+			if (stepX < 0)
+				dhitposy = (float)std::floor(mapY) + (1.f - (dhitposy - (float)std::floor(mapY)));
+
+			dmapY = (int)dhitposy;
+		}
+
+		// if it is still hitting the door, draw it
+		if (dmapX == mapX && dmapY == mapY) {
+			hitpos.x = dhitposx;
+			hitpos.y = dhitposy;
+
+			door = true;
+			map.IsMoving(mapX, mapY, doorAmount);
+
+			// extend perpdist
+			perpdist += p*m_RayTable.GetDoorCos()[x];
+			break;
+		}
+
+		// otherwise, carry on
+		hit = RayCaster::Trace(map, ray);
+	}
+
+	// past the fog only the floor and ceiling show, fading out, but nothing behind it does
+	if (!hit || perpdist >= m_FogDistance) {
+		ClearColumn(x, hit || RayCaster::InFog(map, ray) ? m_FogDistance : std::numeric_limits<float>::max());
+		return;
+	}
+
+	WallSlice slice;
+	slice.cellX = (int)hitpos.x;
+	slice.cellY = (int)hitpos.y;
+	slice.face = cardinal;
+	slice.side = side;
+	slice.position = hitpos;
+	slice.distance = perpdist;
+	slice.door = door;
+	slice.doorAmount = doorAmount;
+
+	// Calculate height of line to draw on screen
+	int screenHeight = m_FrameBuffer.GetHeight();
+	slice.lineHeight = std::abs(int(screenHeight / perpdist));
+
+	// calculate lowest and highest pixel to fill in current stripe
+	slice.drawStart = -int(slice.lineHeight*(1-cam.height)) + screenHeight/2;
+	slice.drawEnd = int(slice.lineHeight*(cam.height)) + screenHeight/2;
+
+	// calculate value of wallX
+	float hitX = (side ? hitpos.x : hitpos.y);
+	float wallX = hitX - std::floor((hitX));
+
+	// x coordinate on the texture
+	bool flip = (!side && rayDirX > 0) || (side && rayDirY < 0);
+	int texX = int(wallX * float(texWidth));
+
+	slice.texX = flip ? texWidth - texX - 1 : texX;
+	slice.u = flip ? 1.f - wallX : wallX;
+
+	// make distant walls darker, and y-sides darker still
+	slice.mod = int(255.f*std::max(0.f, 1.f - dist/m_FogDistance));
+
+	DrawSlice<TexBits>(map, cam, x, slice);
+}
+
+template<bool Doors, int TexBits>
+void Renderer::DrawFixedColumn(const Map &map, const Camera &cam, int x, FixedRay &ray) {
+	const WallAtlas &atlas = map.GetWallAtlas();
+	const int texWidth = TexBits ? 1 << TexBits : atlas.GetTexWidth();
+
+	Fixed posX = ToFixed(cam.position.x);
+	Fixed posY = ToFixed(cam.position.y);
+
+	bool hit = ray.hit;
+	bool door = false;
+	float doorAmount = 0.f;
+	Fixed perpdist = 0;
+	Fixed hitX = 0;
+
+	// the same walk as DrawColumn, with the distance taken to the face plane by one divide
+	while (hit) {
+		perpdist = FixedCaster::GetDistance(ray, cam);
+
+		// where along the face, as a position on the map
+		if (ray.side)
+			hitX = posX + (Fixed)(((sf::Int64)perpdist*ray.rayDirX) >> FIXED_SHIFT);
+		else
+			hitX = posY + (Fixed)(((sf::Int64)perpdist*ray.rayDirY) >> FIXED_SHIFT);
+
+		if (!Doors || !map.IsDoor(ray.mapX, ray.mapY))
+			break;
+
+		// the ray hit a door
+		if (map.IsOpen(ray.mapX, ray.mapY)) {
+			hit = FixedCaster::Trace(map, ray);
+			continue;
+		}
+
+		// doors stand half a cell in
+		Fixed dperpdist = FixedCaster::GetDistance(ray, cam, FIXED_HALF);
+		int cell = ray.side ? ray.mapX : ray.mapY;
+		Fixed corner = cell << FIXED_SHIFT;
+		Fixed dhitX;
+
+		if (ray.side)
+			dhitX = posX + (Fixed)(((sf::Int64)dperpdist*ray.rayDirX) >> FIXED_SHIFT);
+		else
+			dhitX = posY + (Fixed)(((sf::Int64)dperpdist*ray.rayDirY) >> FIXED_SHIFT);
+
+		float amount;
+		if (map.IsMoving(ray.mapX, ray.mapY, amount) && dhitX > corner)
+			dhitX += ToFixed(amount);
+
+		// flip the texture for back faces
+		if ((ray.side && ray.stepY > 0) || (!ray.side && ray.stepX < 0))
+			dhitX = corner + FIXED_ONE - (dhitX - corner);
+
+		// if it is still hitting the door, draw it
+		if ((dhitX >> FIXED_SHIFT) == cell) {
+			hitX = dhitX;
+			perpdist = dperpdist;
+
+			door = true;
+			map.IsMoving(ray.mapX, ray.mapY, doorAmount);
+			break;
+		}
+
+		// otherwise, carry on
+		hit = FixedCaster::Trace(map, ray);
+	}
+
+	if (!hit || perpdist >= ray.maxDist) {
+		ClearColumn(x, hit || FixedCaster::InFog(map, ray) ? m_FogDistance : std::numeric_limits<float>::max());
+		return;
+	}
+
+	bool side = ray.side;
+
+	WallSlice slice;
+	slice.cellX = ray.mapX;
+	slice.cellY = ray.mapY;
+	if (side)
+		slice.face = ray.stepY < 0 ? WallSide::NORTH : WallSide::SOUTH;
+	else
+		slice.face = ray.stepX < 0 ? WallSide::EAST : WallSide::WEST;
+	slice.side = side;
+	slice.position = side ? sf::Vector2f(hitX/(float)FIXED_ONE, (float)ray.mapY) : sf::Vector2f((float)ray.mapX, hitX/(float)FIXED_ONE);
+	slice.distance = perpdist/(float)FIXED_ONE;
+	slice.door = door;
+	slice.doorAmount = doorAmount;
+
+	// column height and span, with the eye height in 1/256ths as the texture walk has it
+	int screenHeight = m_FrameBuffer.GetHeight();
+	int fpHeight = int(256.f*cam.height);
+
+	slice.lineHeight = (int)(((sf::Int64)screenHeight << FIXED_SHIFT)/perpdist);
+	slice.drawStart = screenHeight/2 - slice.lineHeight*(256 - fpHeight)/256;
+	slice.drawEnd = screenHeight/2 + slice.lineHeight*fpHeight/256;
+
+	// texture u from the fraction across the cell, doors are already flipped
+	Fixed wallX = hitX & (FIXED_ONE - 1);
+	bool flip = (!side && ray.rayDirX > 0) || (side && ray.rayDirY < 0);
+	int texX = (int)(((sf::Int64)wallX*texWidth) >> FIXED_SHIFT);
+
+	slice.texX = flip ? texWidth - texX - 1 : texX;
+	slice.u = (flip ? FIXED_ONE - wallX : wallX)/(float)FIXED_ONE;
+
+	// distance along the ray for the shade, falling to black at the fog
+	sf::Int64 dist = ((sf::Int64)perpdist*m_FixedTable.GetLength()[x]) >> FIXED_SHIFT;
+	sf::Int64 far = ray.maxDist;
+	slice.mod = dist < far ? (int)(255*(far - dist)/far) : 0;
+
+	DrawSlice<TexBits>(map, cam, x, slice);
+}
+
+// texel t of a texture size texels across at a mip level, for the generic kernels: sizes that are
+// not powers of two wrap by the remainder, and halving rounded their levels down, so the last
+// texel of the level is as far as it goes
+static inline int ClampTexel(int t, int size, int level) {
+	return std::min(t >> level, (size >> level) - 1);
+}
+
+static inline int WrapTexel(int t, int size, int level) {
+	t %= size;
+	return ClampTexel(t < 0 ? t + size : t, size, level);
+}
+
+void Renderer::ClearColumn(int x, float depth) {
+	int screenHeight = m_FrameBuffer.GetHeight();
+
+	m_FrameBuffer.GetDepthBuffer()[x] = depth;
+	m_WallTop[x] = screenHeight/2;
+	m_WallBottom[x] = screenHeight/2;
+	m_Hits[x] = NoHit();
+}
+
+template<int TexBits>
+void Renderer::DrawSlice(const Map &map, const Camera &cam, int x, const WallSlice &slice) {
+	const WallAtlas &atlas = map.GetWallAtlas();
+	const int texWidth = TexBits ? 1 << TexBits : atlas.GetTexWidth();
+	const int texHeight = TexBits ? 1 << TexBits : atlas.GetTexHeight();
+
+	int screenWidth = m_FrameBuffer.GetWidth();
+	int screenHeight = m_FrameBuffer.GetHeight();
+	int fpHeight = int(256.f*cam.height);
+	int lineHeight = slice.lineHeight;
+
+	// write to depth buffer
+	m_FrameBuffer.GetDepthBuffer()[x] = slice.distance;
+
+	int drawStart = std::max(slice.drawStart, 0);
+	int drawEnd = std::min(slice.drawEnd, screenHeight - 1);
+
+	// texturing calculations, WallSide counts the sides in the map's order
+	int cell = slice.cellY*map.GetWidth() + slice.cellX;
+	int texNum = map.GetFaceTexture(cell, (int)slice.face) - 1;
+
+	if (texNum < 0 || texNum >= atlas.GetTextureCount())
+		texNum = 0;
+
+	ColumnHit &record = m_Hits[x];
+	record.cell = cell;
+	record.face = slice.face;
+	record.position = slice.position;
+	record.distance = slice.distance;
+	record.u = slice.u;
+	record.texture = texNum;
+	record.door = slice.door;
+	record.doorAmount = slice.doorAmount;
+
+	// texture column, read top to bottom from the mip level closest to the column's height
+	int level = atlas.SelectLevel(lineHeight);
+	int texX = TexBits ? slice.texX >> level : ClampTexel(slice.texX, texWidth, level);
+
+	// column of the frame buffer, walked with a stride of one row
+	if (m_Palettized) {
+		sf::Uint8 *column = m_FrameBuffer.GetIndices() + x;
+		const sf::Uint8 *strip = atlas.GetIndexColumn(texNum, texX, level);
+		const sf::Uint8 *colormap = Palette::GetColormap(slice.mod, slice.side);
+
+		for (int y = drawStart; y < drawEnd; y++) {
+			int d = y*256 - screenHeight*128 + lineHeight*(256 - fpHeight);
+			int texY = TexBits ? ((((d * texHeight) / lineHeight) / 256) & (texHeight - 1)) >> level : WrapTexel(((d * texHeight) / lineHeight) / 256, texHeight, level);
+
+			column[y*screenWidth] = colormap[strip[texY]];
+		}
+	} else {
+		sf::Uint32 *column = m_FrameBuffer.GetPixels() + x;
+		const sf::Uint32 *strip = atlas.GetColumn(texNum, texX, level);
+		const sf::Uint8 *shade = ShadeTable::Get(slice.mod, slice.side);
+
+		for (int y = drawStart; y < drawEnd; y++) {
+			int d = y*256 - screenHeight*128 + lineHeight*(256 - fpHeight);
+			int texY = TexBits ? ((((d * texHeight) / lineHeight) / 256) & (texHeight - 1)) >> level : WrapTexel(((d * texHeight) / lineHeight) / 256, texHeight, level);
+
+			column[y*screenWidth] = ShadeTable::Apply(strip[texY], shade);
+		}
+	}
+
+	m_WallTop[x] = drawStart;
+	m_WallBottom[x] = drawEnd;
+}
\ No newline at end of file
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "FrameBuffer.hpp"
+#include "Camera.hpp"
+#include "Map.hpp"
+#include "ThreadPool.hpp"
+#include "RayCaster.hpp"
+#include "FixedCaster.hpp"
+#include "Sprite.hpp"
+#include "DepthHierarchy.hpp"
+#include "FlatCaster.hpp"
+#include "SegmentCaster.hpp"
+
+enum struct WallSide {
+	NORTH,
+	EAST,
+	SOUTH,
+	WEST
+};
+
+// the default fog distance, in cells
+#define FOG_DISTANCE 25.f
+
+// the furthest it goes: 2^30 in 16.16, so the fixed point side distances a cell past it still fit
+#define FOG_MAX_DISTANCE 16384.f
+
+// how the wall pass finds what each column hits
+enum class WallMode {
+	DDA,			// a ray stepped through the grid per column
+	SEGMENTS		// visible faces found once and projected over their columns
+};
+
+// what one column's ray stopped on, kept with the frame so picking and gameplay queries
+// read it instead of casting again
+struct ColumnHit {
+	int				cell;			// map cell, -1 if the ray left the map
+	WallSide		face;
+	sf::Vector2f	position;		// on the map, (-1, -1) for nothing
+	float			distance;		// perpendicular, as in the depth buffer
+	float			u;				// across the face as the texture is read, 0 to 1
+	int				texture;		// in the wall atlas
+	bool			door;
+	float			doorAmount;		// how far a moving door has slid open
+};
+
+// labels of Renderer::GetObjectImage, the kind in the top byte and an index in the rest:
+// the map cell for walls, the position in the list given to DrawSprites for sprites
+enum class ObjectKind : sf::Uint32 {
+	NONE,
+	CEILING,
+	FLOOR,
+	WALL,
+	SPRITE
+};
+
+inline sf::Uint32 MakeObjectId(ObjectKind kind, sf::Uint32 index) {
+	return ((sf::Uint32)kind << 24) | (index & 0xFFFFFF);
+}
+
+inline ObjectKind GetObjectKind(sf::Uint32 id) {
+	return (ObjectKind)(id >> 24);
+}
+
+inline sf::Uint32 GetObjectIndex(sf::Uint32 id) {
+	return id & 0xFFFFFF;
+}
+
+// a column's wall as either column kernel works it out, for the drawing they share
+struct WallSlice {
+	int				cellX;
+	int				cellY;
+	WallSide		face;
+	bool			side;			// y-side, drawn darker
+	sf::Vector2f	position;
+	float			distance;
+	float			u;
+	int				texX;			// at the top mip level, already flipped
+	int				lineHeight;
+	int				drawStart;		// unclipped
+	int				drawEnd;
+	int				mod;			// distance shade
+	bool			door;
+	float			doorAmount;
+};
+
+// a sprite projected onto the screen, worked out once per frame
+struct ProjectedSprite {
+	Sprite				*sprite;
+	int					index;			// in the list given to DrawSprites
+	const SpriteSheet	*sheet;
+	int					level;
+	sf::IntRect			rect;			// frame at that level
+
+	int					screenX;		// unclipped left edge
+	int					width;
+	int					xBegin;			// clipped columns
+	int					xEnd;
+	float				top;
+	float				height;
+
+	float				depth;
+	bool				depthTest;		// false if it is in front of every wall it covers
+	bool				translucent;	// the level has partly transparent texels to blend
+	const sf::Uint8		*shade;
+};
+
+// software renderer core, casts a map into a frame buffer without touching a window
+class Renderer {
+public:
+	Renderer(int width, int height);
+
+	void SetSize(int width, int height);
+	void SetThreadPool(ThreadPool *pool);
+	int GetWidth() const;
+	int GetHeight() const;
+
+	// with incremental rendering on (the default) a frame with the same camera and size as the
+	// last only redraws the columns that look through map cells changed since then
+	void SetIncremental(bool incremental);
+	bool IsIncremental() const;
+
+	// the 8-bit pipeline: textures are read as indices into the shared Palette, shaded through its
+	// colormaps into an index frame, and turned into pixels once at the end of DrawSprites. stays
+	// off unless Palette::SetEnabled(true) came before the textures were loaded
+	void SetPalettized(bool palettized);
+	bool IsPalettized() const;
+
+	void SetWallMode(WallMode mode);
+	WallMode GetWallMode() const;
+
+	// with fixed point on the walls are cast and projected in 16.16 integer arithmetic (FixedCaster),
+	// so a camera gives the same column heights, texture coordinates and shades on any compiler or
+	// CPU. it always steps the grid per column, whatever the wall mode. off by default
+	void SetFixedPoint(bool fixedPoint);
+	bool IsFixedPoint() const;
+
+	// how far the walls and floor fade to black, and the rays give up: past it nothing is
+	// drawn and the depth buffer holds the fog distance, so sprites behind it are culled too.
+	// kept between 1 and FOG_MAX_DISTANCE cells
+	void SetFogDistance(float fogDistance);
+	float GetFogDistance() const;
+	const SegmentCaster &GetSegmentCaster() const;
+
+	void Render(const Map &map, const Camera &cam);
+
+	// composite sprites into the last frame, depth tested against its walls, sorted back to front.
+	// when rendering incrementally the last frame's sprites are kept in the columns that were not
+	// redrawn, and the palettized frame is only resolved here, so this has to be called every frame
+	void DrawSprites(const std::vector<Sprite *> &sprites, const Camera &cam);
+
+	// sprites the last DrawSprites skipped because walls hid all of them, or their cell
+	// was out of the camera cell's visible set
+	int GetCulledSprites() const;
+
+	// columns the last frame cast again, the full width unless it was drawn incrementally
+	int GetRedrawnColumns() const;
+
+	const FrameBuffer &GetFrameBuffer() const;
+
+	// what the centre column of the last frame hit, (-1, -1) for nothing
+	const sf::Vector2f &GetHitCoords() const;
+	WallSide GetHitSide() const;
+
+	// what column x of the last frame hit
+	const ColumnHit &GetColumnHit(int x) const;
+
+	// with sprite coverage on, DrawSprites also records which sprite drew each pixel, for
+	// GetSpriteAt and the sprites in GetObjectImage. off by default
+	void SetSpriteCoverage(bool coverage);
+	bool HasSpriteCoverage() const;
+
+	// the sprite drawn at (x, y) in the last frame, nullptr for none (or without sprite coverage)
+	Sprite *GetSpriteAt(int x, int y) const;
+
+	// per pixel images of the last frame, row by row like the pixels: the distance along the view
+	// direction of whatever was drawn, and its label (see ObjectKind)
+	void GetDepthImage(std::vector<float> &depth) const;
+	void GetObjectImage(std::vector<sf::Uint32> &ids) const;
+
+private:
+	// each band only touches its own columns (or rows), so bands can run in parallel
+	void CastWalls(const Map &map, const Camera &cam, int xBegin, int xEnd);
+	void UpdateRows(const Map &map, const Camera &cam);
+
+	// Pixel is sf::Uint32 for packed pixels or sf::Uint8 for palette indices
+	template<typename Pixel>
+	void FillBackground(const Map &map, int yBegin, int yEnd);
+	template<typename Pixel>
+	void FillColumns(const Map &map, int xBegin, int xEnd);
+	template<typename Pixel>
+	void CompositeSprites(int xBegin, int xEnd);
+	void ClearCoverage(int yBegin, int yEnd);
+
+	// specialised on whether the map has doors and on the texture size (log2, 0 for any),
+	// one instantiation is picked per frame
+	template<bool Doors, int TexBits>
+	void DrawColumn(const Map &map, const Camera &cam, int x, Ray &ray);
+	template<bool Doors, int TexBits>
+	void DrawFixedColumn(const Map &map, const Camera &cam, int x, FixedRay &ray);
+	void SelectKernels(const Map &map);
+
+	// the part of a column both kernels share, and the column of a ray that hit nothing before
+	// `depth`, which is the fog distance if it stopped in the fog or the most a float holds
+	template<int TexBits>
+	void DrawSlice(const Map &map, const Camera &cam, int x, const WallSlice &slice);
+	void ClearColumn(int x, float depth);
+
+	// redraw the runs of columns in [xBegin, xEnd) marked with `mark`
+	void RedrawColumns(const Map &map, const Camera &cam, int xBegin, int xEnd, sf::Uint8 mark);
+	int RedrawMarked(const Map &map, const Camera &cam, sf::Uint8 mark);
+
+	// mark the columns whose rays could pass through cell p
+	void MarkCell(const Map &map, const Camera &cam, int p);
+
+	typedef void (Renderer::*ColumnKernel)(const Map &, const Camera &, int, Ray &);
+	typedef void (Renderer::*FixedColumnKernel)(const Map &, const Camera &, int, FixedRay &);
+
+private:
+	FrameBuffer		m_FrameBuffer;
+	ThreadPool		*m_ThreadPool;
+	RayTable		m_RayTable;
+	bool			m_Palettized;
+	WallMode		m_WallMode;
+	SegmentCaster	m_Segments;
+	ColumnKernel	m_DrawColumn;
+
+	bool				m_FixedPoint;
+	FixedRayTable		m_FixedTable;
+	FixedColumnKernel	m_DrawFixedColumn;
+	float				m_FogDistance;
+
+	// first and one past the last row each column's wall covers
+	std::vector<int>	m_WallTop;
+	std::vector<int>	m_WallBottom;
+
+	// floor and ceiling distance of each row, kept while the height and eye height hold,
+	// and where each row starts in the textures this frame
+	std::vector<float>		m_RowDist;
+	int						m_RowDistHeight;
+	float					m_RowDistEye;
+	std::vector<FlatRow>	m_Rows;
+
+	std::vector<ProjectedSprite>	m_Projected;
+	std::vector<ProjectedSprite>	m_LastProjected;
+	DepthHierarchy					m_DepthHierarchy;
+	int								m_CulledSprites;
+
+	// per column hits, and per pixel the projected sprite drawn there plus one (0 for none), as
+	// wide as the object ids so no count of sprites wraps it
+	std::vector<ColumnHit>			m_Hits;
+	bool							m_SpriteCoverage;
+	std::vector<sf::Uint32>			m_Coverage;
+
+	// what the last frame was drawn from, and which columns this one redraws
+	bool					m_Incremental;
+	bool					m_HasFrame;
+	bool					m_FullFrame;
+	const Map				*m_LastMap;
+	unsigned int			m_MapRevision;
+	Camera					m_LastCamera;
+	std::vector<sf::Uint8>	m_Dirty;
+	std::vector<int>		m_ChangedCells;
+	int						m_RedrawnColumns;
+};
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "ResolutionGovernor.hpp"
+
+#include <algorithm>
+
+#define SCALE_STEP 0.125f
+#define SCALE_MIN 0.25f
+
+// frames to wait after a change before judging the new scale
+#define SCALE_COOLDOWN 8
+
+// only step back up when a frame would still fit after the extra pixels
+#define SCALE_HEADROOM 0.75f
+
+ResolutionGovernor::ResolutionGovernor(float targetMs)
+	: m_Target(targetMs), m_Average(0.f), m_Cooldown(0), m_Scale(1.f, 1.f)
+{
+
+}
+
+void ResolutionGovernor::SetTarget(float targetMs) {
+	m_Target = targetMs;
+	m_Cooldown = 0;
+
+	if (m_Target <= 0.f)
+		m_Scale = sf::Vector2f(1.f, 1.f);
+}
+
+float ResolutionGovernor::GetTarget() const {
+	return m_Target;
+}
+
+bool ResolutionGovernor::Update(float frameMs) {
+	// smooth out single slow frames
+	m_Average = m_Average > 0.f ? m_Average*0.9f + frameMs*0.1f : frameMs;
+
+	sf::Vector2f old = m_Scale;
+
+	if (m_Target > 0.f && m_Cooldown > 0)
+		m_Cooldown--;
+	else if (m_Target > 0.f) {
+		if (m_Average > m_Target) {
+			// columns cost the most, so horizontal goes first and vertical follows it down
+			if (m_Scale.x >= m_Scale.y && m_Scale.x > SCALE_MIN)
+				m_Scale.x -= SCALE_STEP;
+			else if (m_Scale.y > SCALE_MIN)
+				m_Scale.y -= SCALE_STEP;
+		} else if (m_Average < m_Target*SCALE_HEADROOM) {
+			// and come back in the opposite order
+			if (m_Scale.y <= m_Scale.x && m_Scale.y < 1.f)
+				m_Scale.y += SCALE_STEP;
+			else if (m_Scale.x < 1.f)
+				m_Scale.x += SCALE_STEP;
+		}
+	}
+
+	m_History.push_back(m_Scale);
+	if (m_History.size() > GOVERNOR_HISTORY)
+		m_History.pop_front();
+
+	if (m_Scale == old)
+		return false;
+
+	// the average was measured at the old size, scale it by the change in area
+	m_Average *= (m_Scale.x*m_Scale.y)/(old.x*old.y);
+	m_Cooldown = SCALE_COOLDOWN;
+	return true;
+}
+
+const sf::Vector2f &ResolutionGovernor::GetScale() const {
+	return m_Scale;
+}
+
+sf::Vector2u ResolutionGovernor::GetResolution(const sf::Vector2u &window) const {
+	return sf::Vector2u(std::max(1u, (unsigned int)(window.x*m_Scale.x)), std::max(1u, (unsigned int)(window.y*m_Scale.y)));
+}
+
+const std::deque<sf::Vector2f> &ResolutionGovernor::GetHistory() const {
+	return m_History;
+}
\ No newline at end of file
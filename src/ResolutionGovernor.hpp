@@ -0,0 +1,34 @@
+#pragma once
+
+#include <deque>
+#include <SFML/System/Vector2.hpp>
+
+#define GOVERNOR_HISTORY 240
+
+// picks the internal render resolution as a fraction of the window, stepping the horizontal
+// and vertical scale down when frames run over the target time and back up when there is room
+class ResolutionGovernor {
+public:
+	// a target of 0 keeps full resolution
+	explicit ResolutionGovernor(float targetMs=0.f);
+
+	void SetTarget(float targetMs);
+	float GetTarget() const;
+
+	// feed the time the last frame took to render, returns true if the scale changed
+	bool Update(float frameMs);
+
+	const sf::Vector2f &GetScale() const;
+	sf::Vector2u GetResolution(const sf::Vector2u &window) const;
+
+	// the scale after each of the last GOVERNOR_HISTORY updates, oldest first
+	const std::deque<sf::Vector2f> &GetHistory() const;
+
+private:
+	float						m_Target;
+	float						m_Average;
+	int							m_Cooldown;
+
+	sf::Vector2f				m_Scale;
+	std::deque<sf::Vector2f>	m_History;
+};
\ No newline at end of file
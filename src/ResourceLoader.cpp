@@ -3,6 +3,7 @@
 std::map<std::string, sf::Texture *>	ResourceLoader::m_Textures;
 std::map<std::string, sf::Image *>	ResourceLoader::m_Images;
 std::map<std::string, sf::SoundBuffer *> ResourceLoader::m_Sounds;
+std::map<std::string, SpriteSheet *> ResourceLoader::m_SpriteSheets;
 
 sf::Texture *ResourceLoader::GetTexture(const std::string &name) {
 	if (m_Textures.count(name) == 1) {
@@ -40,6 +41,17 @@ sf::SoundBuffer *ResourceLoader::GetSoundBuffer(const std::string &name) {
 	return t;
 }
 
+SpriteSheet *ResourceLoader::GetSpriteSheet(const std::string &name, const sf::Vector2u &frameSize) {
+	if (m_SpriteSheets.count(name) == 1) {
+		return m_SpriteSheets.at(name);
+	}
+
+	SpriteSheet *t = new SpriteSheet(*GetImage(name), frameSize);
+	m_SpriteSheets[name] = t;
+
+	return t;
+}
+
 void ResourceLoader::ShutDown() {
 	for (auto &pair : m_Images) {
 		delete pair.second;
@@ -52,4 +64,8 @@ void ResourceLoader::ShutDown() {
 	for (auto &pair : m_Sounds) {
 		delete pair.second;
 	}
+
+	for (auto &pair : m_SpriteSheets) {
+		delete pair.second;
+	}
 }
\ No newline at end of file
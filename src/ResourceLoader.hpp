@@ -4,11 +4,14 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
 
+#include "SpriteSheet.hpp"
+
 class ResourceLoader {
 public:
 	static sf::Texture		*GetTexture(const std::string &name);
 	static sf::Image		*GetImage(const std::string &name);
 	static sf::SoundBuffer	*GetSoundBuffer(const std::string &name);
+	static SpriteSheet		*GetSpriteSheet(const std::string &name, const sf::Vector2u &frameSize);
 
 	static void ShutDown();
 
@@ -16,4 +19,5 @@ private:
 	static std::map<std::string, sf::Texture *>		m_Textures;
 	static std::map<std::string, sf::Image *>		m_Images;
 	static std::map<std::string, sf::SoundBuffer *> m_Sounds;
+	static std::map<std::string, SpriteSheet *>		m_SpriteSheets;
 };
\ No newline at end of file
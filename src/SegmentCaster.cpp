@@ -0,0 +1,267 @@
+#include "SegmentCaster.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+SegmentCaster::SegmentCaster()
+	: m_Width(0), m_MapWidth(0), m_Stamp(0), m_Faces(0), m_FallbackCount(0)
+{
+
+}
+
+bool SegmentCaster::Project(const Camera &cam, const float *px, const float *py, int n, int &xBegin, int &xEnd, float &nearest) const {
+	const sf::Vector2f &look = cam.forward;
+	const sf::Vector2f &right = cam.right;
+	float invDet = 1.0f / (right.x * look.y - look.x * right.y);
+
+	float left = std::numeric_limits<float>::max();
+	float rightmost = -std::numeric_limits<float>::max();
+	int behind = 0;
+
+	nearest = std::numeric_limits<float>::max();
+
+	for (int i=0; i<n; ++i) {
+		float relX = px[i] - cam.position.x;
+		float relY = py[i] - cam.position.y;
+
+		float transformX = invDet * (look.y * relX - look.x * relY);
+		float transformY = invDet * (-right.y * relX + right.x * relY);
+
+		if (transformY <= 0.f) {
+			behind++;
+			continue;
+		}
+
+		float screenX = (m_Width / 2) * (1 + transformX / transformY);
+		left = std::min(left, screenX);
+		rightmost = std::max(rightmost, screenX);
+		nearest = std::min(nearest, transformY);
+	}
+
+	if (behind == n)
+		return false;
+
+	// straddling the camera plane, it could be anywhere
+	if (behind > 0) {
+		xBegin = 0;
+		xEnd = m_Width;
+		nearest = 0.f;
+		return true;
+	}
+
+	xBegin = std::max(0, int(std::floor(left)) - 1);
+	xEnd = std::min(m_Width, int(std::ceil(rightmost)) + 2);
+	return xBegin < xEnd;
+}
+
+void SegmentCaster::AddFace(const Map &map, const RayTable &table, const Camera &cam, int cellX, int cellY, int wallX, int wallY) {
+	const sf::Vector2f &pos = cam.position;
+	bool side = wallY != cellY;
+
+	// the face is the edge shared with the empty cell, it is only seen from that side
+	float plane = side ? (float)std::max(cellY, wallY) : (float)std::max(cellX, wallX);
+	float eye = side ? pos.y : pos.x;
+
+	if ((side ? wallY > cellY : wallX > cellX) ? eye >= plane : eye <= plane)
+		return;
+
+	float px[2], py[2];
+	if (side) {
+		px[0] = (float)wallX; px[1] = wallX + 1.f;
+		py[0] = py[1] = plane;
+	} else {
+		px[0] = px[1] = plane;
+		py[0] = (float)wallY; py[1] = wallY + 1.f;
+	}
+
+	int xBegin, xEnd;
+	float nearest;
+	if (!Project(cam, px, py, 2, xBegin, xEnd, nearest))
+		return;
+
+	m_Faces++;
+
+	const float *rayDirX = table.GetRayDirX();
+	const float *rayDirY = table.GetRayDirY();
+	int cell = wallY*map.GetWidth() + wallX;
+
+	// where each column's ray meets the face's line, with the DDA's own arithmetic, kept if it
+	// lands inside the face and is nearer than anything found before
+	for (int x = xBegin; x < xEnd; x++) {
+		if (side) {
+			int stepY = rayDirY[x] < 0 ? -1 : 1;
+			float perpdist = (wallY - pos.y + (1 - stepY) / 2) / rayDirY[x];
+			if (!(perpdist > 0.f) || perpdist >= m_Depth[x])
+				continue;
+
+			float hitX = pos.x + perpdist * rayDirX[x];
+			if (hitX < wallX || hitX >= wallX + 1)
+				continue;
+
+			m_Depth[x] = perpdist;
+		} else {
+			int stepX = rayDirX[x] < 0 ? -1 : 1;
+			float perpdist = (wallX - pos.x + (1 - stepX) / 2) / rayDirX[x];
+			if (!(perpdist > 0.f) || perpdist >= m_Depth[x])
+				continue;
+
+			float hitY = pos.y + perpdist * rayDirY[x];
+			if (hitY < wallY || hitY >= wallY + 1)
+				continue;
+
+			m_Depth[x] = perpdist;
+		}
+
+		m_Cell[x] = cell;
+		m_Side[x] = side;
+	}
+}
+
+void SegmentCaster::AddFallback(const Camera &cam, int cellX, int cellY) {
+	float px[4] = { (float)cellX, cellX + 1.f, (float)cellX, cellX + 1.f };
+	float py[4] = { (float)cellY, (float)cellY, cellY + 1.f, cellY + 1.f };
+
+	int xBegin, xEnd;
+	float nearest;
+	if (!Project(cam, px, py, 4, xBegin, xEnd, nearest))
+		return;
+
+	for (int x = xBegin; x < xEnd; x++)
+		m_Fallback[x] = 1;
+}
+
+void SegmentCaster::Cast(const Map &map, const RayTable &table, const Camera &cam, float fogDistance) {
+	m_Width = table.GetWidth();
+	m_Depth.assign(m_Width, std::numeric_limits<float>::max());
+	m_Cell.assign(m_Width, -1);
+	m_Side.assign(m_Width, 0);
+	m_Fallback.assign(m_Width, 0);
+	m_Faces = 0;
+	m_FallbackCount = 0;
+
+	int mw = map.GetWidth();
+	int mh = map.GetHeight();
+	m_MapWidth = mw;
+	int startX = int(cam.position.x);
+	int startY = int(cam.position.y);
+
+	// stamps save clearing the whole map every frame
+	if (m_Visited.size() != (size_t)(mw*mh)) {
+		m_Visited.assign(mw*mh, 0);
+		m_Stamp = 0;
+	}
+
+	if (++m_Stamp == 0) {
+		std::fill(m_Visited.begin(), m_Visited.end(), 0);
+		m_Stamp = 1;
+	}
+
+	// standing in a door, or off the map, leave it all to the DDA
+	if (startX < 0 || startX >= mw || startY < 0 || startY >= mh || map.IsDoor(startX, startY)) {
+		std::fill(m_Fallback.begin(), m_Fallback.end(), 1);
+		m_FallbackCount = m_Width;
+		return;
+	}
+
+	static const int dx[4] = { 1, -1, 0, 0 };
+	static const int dy[4] = { 0, 0, 1, -1 };
+
+	// breadth first through the empty cells, so nearer faces tend to land first and the
+	// cells they hide are never expanded
+	m_Queue.clear();
+	m_Queue.push_back(startY*mw + startX);
+	m_Visited[startY*mw + startX] = m_Stamp;
+
+	for (size_t head = 0; head < m_Queue.size(); ++head) {
+		int cx = m_Queue[head] % mw;
+		int cy = m_Queue[head] / mw;
+
+		for (int i=0; i<4; ++i) {
+			int nx = cx + dx[i];
+			int ny = cy + dy[i];
+
+			if (nx < 0 || nx >= mw || ny < 0 || ny >= mh)
+				continue;
+
+			int n = ny*mw + nx;
+
+			// doors open, slide and inset, the DDA deals with whatever is behind them
+			if (map.IsDoor(n)) {
+				AddFallback(cam, nx, ny);
+				continue;
+			}
+
+			if (map.IsWall(nx, ny)) {
+				AddFace(map, table, cam, cx, cy, nx, ny);
+				continue;
+			}
+
+			if (m_Visited[n] == m_Stamp)
+				continue;
+			m_Visited[n] = m_Stamp;
+
+			float px[4] = { (float)nx, nx + 1.f, (float)nx, nx + 1.f };
+			float py[4] = { (float)ny, (float)ny, ny + 1.f, ny + 1.f };
+
+			int xBegin, xEnd;
+			float nearest;
+			if (!Project(cam, px, py, 4, xBegin, xEnd, nearest))
+				continue;
+
+			// in the fog, as is all that is seen through it, the columns left are traced to it
+			if (nearest >= fogDistance)
+				continue;
+
+			// hidden behind faces already found in every column it covers
+			bool hidden = true;
+			for (int x = xBegin; hidden && x < xEnd; x++)
+				hidden = m_Depth[x] < nearest;
+
+			if (!hidden)
+				m_Queue.push_back(n);
+		}
+	}
+
+	// columns where nothing was found, out into the open or through a corner seam, are traced
+	for (int x = 0; x < m_Width; x++) {
+		if (m_Cell[x] < 0)
+			m_Fallback[x] = 1;
+
+		m_FallbackCount += m_Fallback[x];
+	}
+}
+
+bool SegmentCaster::GetRay(const RayTable &table, int x, Ray &ray) const {
+	if (m_Fallback[x])
+		return false;
+
+	ray.rayDirX = table.GetRayDirX()[x];
+	ray.rayDirY = table.GetRayDirY()[x];
+	ray.deltaDistX = table.GetDeltaDistX()[x];
+	ray.deltaDistY = table.GetDeltaDistY()[x];
+	ray.sideDistX = 0.f;
+	ray.sideDistY = 0.f;
+	ray.startDistX = 0.f;
+	ray.startDistY = 0.f;
+	ray.stepsX = 0;
+	ray.stepsY = 0;
+	ray.maxDist = table.GetMaxDist()[x];
+
+	ray.mapX = m_Cell[x] % m_MapWidth;
+	ray.mapY = m_Cell[x] / m_MapWidth;
+	ray.stepX = ray.rayDirX < 0 ? -1 : 1;
+	ray.stepY = ray.rayDirY < 0 ? -1 : 1;
+	ray.side = m_Side[x] != 0;
+	ray.hit = true;
+
+	return true;
+}
+
+int SegmentCaster::GetFaceCount() const {
+	return m_Faces;
+}
+
+int SegmentCaster::GetFallbackCount() const {
+	return m_FallbackCount;
+}
\ No newline at end of file
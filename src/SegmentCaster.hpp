@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "Camera.hpp"
+#include "Map.hpp"
+#include "RayCaster.hpp"
+
+// finds the wall faces in view once per frame, walking the empty cells outward from the camera,
+// and projects each face onto the columns it spans instead of stepping a ray through every column
+class SegmentCaster {
+public:
+	SegmentCaster();
+
+	// cells whose nearest corner is past the fog are not expanded, nothing through them is drawn
+	void Cast(const Map &map, const RayTable &table, const Camera &cam, float fogDistance);
+
+	// the ray as the DDA would have left it on the face column x sees, false for columns that
+	// need the DDA (doors, or nothing found)
+	bool GetRay(const RayTable &table, int x, Ray &ray) const;
+
+	// faces projected and columns handed back to the DDA in the last Cast
+	int GetFaceCount() const;
+	int GetFallbackCount() const;
+
+private:
+	// the columns a set of points covers, false if all of them are behind the camera
+	bool Project(const Camera &cam, const float *px, const float *py, int n, int &xBegin, int &xEnd, float &nearest) const;
+
+	void AddFace(const Map &map, const RayTable &table, const Camera &cam, int cellX, int cellY, int wallX, int wallY);
+	void AddFallback(const Camera &cam, int cellX, int cellY);
+
+private:
+	int						m_Width;
+	int						m_MapWidth;
+
+	// nearest face found so far for each column
+	std::vector<float>		m_Depth;
+	std::vector<int>		m_Cell;
+	std::vector<sf::Uint8>	m_Side;
+	std::vector<sf::Uint8>	m_Fallback;
+
+	// cells reached this frame carry the current stamp, a byte a cell and cleared when it wraps
+	std::vector<sf::Uint8>	m_Visited;
+	sf::Uint8				m_Stamp;
+	std::vector<int>		m_Queue;
+
+	int						m_Faces;
+	int						m_FallbackCount;
+};
\ No newline at end of file
@@ -0,0 +1,659 @@
+#include "SelfTest.hpp"
+#include "Camera.hpp"
+#include "CellCodec.hpp"
+#include "FixedCaster.hpp"
+#include "Map.hpp"
+#include "RayCaster.hpp"
+#include "Renderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#define SELFTEST_MAP "Maps/E1M1.rcm"
+#define SELFTEST_SEED 20
+
+// the map file checks save with a sheet of 48 texel tiles, so the header's tile size is not the
+// default, and textured flats. the files are removed after
+#define SELFTEST_TEXTURE "Images/walls48.png"
+#define SELFTEST_TILE_SIZE 48
+#define SELFTEST_FLOOR 42
+#define SELFTEST_CEILING 1
+#define SELFTEST_FILE "Maps/selftest.rcm"
+#define SELFTEST_DAMAGED_FILE "Maps/selftest_damaged.rcm"
+#define SELFTEST_UNWRITABLE_FILE "Maps/selftest_missing/selftest.rcm"
+
+// where a version 2 header keeps the offset of the planes a raw file stores
+#define SELFTEST_PLANE_OFFSET 168
+
+// random cameras and columns for the ray checks, and random edits for the map checks, looked
+// over every SELFTEST_CHECK_EVERY of them
+#define SELFTEST_CAMERAS 600
+#define SELFTEST_COLUMNS 97
+#define SELFTEST_EDITS 300
+#define SELFTEST_CHECK_EVERY 30
+
+// cameras for each look at the visible sets, and how few squares the sets worked out on blocks
+// get: E1M1 in blocks of 2x2
+#define SELFTEST_VISIBLE_CAMERAS 100
+#define SELFTEST_BLOCK_SQUARES 160
+
+#define FOV 65
+#define PI 3.14159265359f
+
+bool SelfTest::Run() {
+	std::mt19937 random(SELFTEST_SEED);
+	bool ok = true;
+
+	std::cout << "checking " << SELFTEST_MAP << std::endl;
+
+	ok = CheckRays(random) && ok;
+	ok = CheckDistanceField(random) && ok;
+	ok = CheckDoors(random) && ok;
+	ok = CheckPlanes(random) && ok;
+	ok = CheckVisibleSet(random) && ok;
+	ok = CheckMapFile(random, false) && ok;
+	ok = CheckMapFile(random, true) && ok;
+
+	std::cout << (ok ? "self test passed" : "self test FAILED") << std::endl;
+	return ok;
+}
+
+bool SelfTest::Report(const std::string &what, int bad, const std::string &wrong) {
+	std::cout << what;
+
+	if (bad > 0) {
+		std::cout << ", " << bad << " " << wrong << std::endl;
+		return false;
+	}
+
+	std::cout << ", ok" << std::endl;
+	return true;
+}
+
+// `count` edits, edit(e) making the e'th, with check() counting what is wrong before the first and
+// after every SELFTEST_CHECK_EVERY of them (every one if each is true). returns all it counted
+template<typename Edit, typename Check>
+static int EditAtRandom(int count, bool each, Edit edit, Check check) {
+	int bad = check();
+
+	for (int e=0; e<count; ++e) {
+		edit(e);
+
+		if (each || (e + 1)%SELFTEST_CHECK_EVERY == 0)
+			bad += check();
+	}
+
+	return bad;
+}
+
+// a random cell inside the outer wall
+static int GetRandomCell(const Map &map, std::mt19937 &random) {
+	int x = 1 + random()%(map.GetWidth() - 2);
+	int y = 1 + random()%(map.GetHeight() - 2);
+
+	return y*map.GetWidth() + x;
+}
+
+// anything at all: empty, or any faces with any flags
+static Wall GetRandomWall(std::mt19937 &random) {
+	Wall wall;
+
+	if (random()%2) {
+		wall.north = random()%64;
+		wall.east = random()%64;
+		wall.south = random()%64;
+		wall.west = random()%64;
+		wall.flags = random()%8;
+	}
+
+	return wall;
+}
+
+// a wall put up or knocked down inside the outer wall, doors kept
+static void ToggleWall(Map &map, std::mt19937 &random) {
+	int p = GetRandomCell(map, random);
+
+	if (!map.IsDoor(p))
+		map.Set(p, map.IsWall(p) ? Wall() : map.Get(0));
+}
+
+// the DDA without leaps or the map's border, checking bounds every step. visit(x, y) is given
+// every cell it steps into, the one it stops on too
+template<typename Visit>
+static void StepRay(const Map &map, Ray &ray, Visit visit) {
+	while (std::min(ray.sideDistX, ray.sideDistY) < ray.maxDist) {
+		if (ray.sideDistX < ray.sideDistY) {
+			ray.stepsX++;
+			ray.sideDistX = ray.startDistX + (float)ray.stepsX*ray.deltaDistX;
+			ray.mapX += ray.stepX;
+			ray.side = false;
+		} else {
+			ray.stepsY++;
+			ray.sideDistY = ray.startDistY + (float)ray.stepsY*ray.deltaDistY;
+			ray.mapY += ray.stepY;
+			ray.side = true;
+		}
+
+		if (!map.IsInside(ray.mapX, ray.mapY))
+			break;
+
+		visit(ray.mapX, ray.mapY);
+		if (map.IsWall(ray.mapX, ray.mapY)) {
+			ray.hit = true;
+			return;
+		}
+	}
+
+	ray.hit = false;
+}
+
+static void StepRay(const Map &map, Ray &ray) {
+	StepRay(map, ray, [](int, int) {});
+}
+
+static void StepRay(const Map &map, FixedRay &ray) {
+	while (std::min(ray.sideDistX, ray.sideDistY) < ray.maxDist) {
+		if (ray.sideDistX < ray.sideDistY) {
+			ray.sideDistX += ray.deltaDistX;
+			ray.mapX += ray.stepX;
+			ray.side = false;
+		} else {
+			ray.sideDistY += ray.deltaDistY;
+			ray.mapY += ray.stepY;
+			ray.side = true;
+		}
+
+		if (!map.IsInside(ray.mapX, ray.mapY))
+			break;
+
+		if (map.IsWall(ray.mapX, ray.mapY)) {
+			ray.hit = true;
+			return;
+		}
+	}
+
+	ray.hit = false;
+}
+
+// the same wall and side distances, or both stopped in the fog or both off the map
+static bool SameRay(const Map &map, const Ray &a, const Ray &b) {
+	if (a.hit != b.hit)
+		return false;
+
+	if (!a.hit)
+		return RayCaster::InFog(map, a) == RayCaster::InFog(map, b);
+
+	return a.mapX == b.mapX && a.mapY == b.mapY && a.side == b.side && a.sideDistX == b.sideDistX && a.sideDistY == b.sideDistY;
+}
+
+static bool SameRay(const Map &map, const FixedRay &a, const FixedRay &b) {
+	if (a.hit != b.hit)
+		return false;
+
+	if (!a.hit)
+		return FixedCaster::InFog(map, a) == FixedCaster::InFog(map, b);
+
+	return a.mapX == b.mapX && a.mapY == b.mapY && a.side == b.side && a.sideDistX == b.sideDistX && a.sideDistY == b.sideDistY;
+}
+
+// how far a cell is from the nearest wall or the edge of the map, counted in squares around it
+static int GetWallDistance(const Map &map, int x, int y) {
+	if (map.IsWall(x, y))
+		return 0;
+
+	for (int r=1; r<255; ++r) {
+		for (int i=-r; i<=r; ++i) {
+			int ring[4][2] = { { x + i, y - r }, { x + i, y + r }, { x - r, y + i }, { x + r, y + i } };
+
+			for (const int *c : ring)
+				if (!map.IsInside(c[0], c[1]) || map.IsWall(c[0], c[1]))
+					return r;
+		}
+	}
+
+	return 255;
+}
+
+bool SelfTest::CheckRays(std::mt19937 &random) {
+	Map map(SELFTEST_MAP, nullptr);
+	RayTable table;
+	FixedRayTable fixedTable;
+
+	int width = map.GetWidth();
+	int height = map.GetHeight();
+	int packet = RayCaster::GetPacketWidth();
+	int rays = 0;
+	int bad = 0;
+
+	for (int pass=0; pass<2; ++pass) {
+		// then again with long open stretches for the leaps to cross, doors kept
+		if (pass == 1) {
+			for (int y=1; y<height-1; ++y)
+				for (int x=1; x<width-1; ++x)
+					if (!map.IsDoor(x, y))
+						map.Set(x, y, random()%40 ? Wall() : map.Get(0));
+		}
+
+		for (int c=0; c<SELFTEST_CAMERAS; ++c) {
+			// no fog to speak of, the default, and short
+			float fog = c%3 == 0 ? 1000.f : c%3 == 1 ? FOG_DISTANCE : 4.f + random()%100/10.f;
+
+			sf::Vector2f pos(1.f + random()%((width - 2)*100)/100.f, 1.f + random()%((height - 2)*100)/100.f);
+			float angle = c%7 == 0 ? (random()%4)*PI/2.f : random()%3600/10.f*PI/180.f;
+			Camera cam(pos, sf::Vector2f(std::cos(angle), std::sin(angle)), FOV*PI/180.f);
+
+			if (map.IsWall((int)pos.x, (int)pos.y))
+				continue;
+
+			table.Update(cam, SELFTEST_COLUMNS, fog);
+			fixedTable.Update(cam, SELFTEST_COLUMNS, fog);
+
+			for (int x=0; x<SELFTEST_COLUMNS; ++x) {
+				Ray ray, plain;
+				RayCaster::Setup(table, cam, x, ray);
+				plain = ray;
+				RayCaster::Trace(map, ray);
+				StepRay(map, plain);
+
+				FixedRay fixedRay, fixedPlain;
+				FixedCaster::Setup(fixedTable, cam, x, fixedRay);
+				fixedPlain = fixedRay;
+				FixedCaster::Trace(map, fixedRay);
+				StepRay(map, fixedPlain);
+
+				rays += 2;
+				bad += !SameRay(map, ray, plain) + !SameRay(map, fixedRay, fixedPlain);
+			}
+
+			// the packets, each lane against a ray of its own
+			for (int x=0; x + packet <= SELFTEST_COLUMNS; x += packet) {
+				Ray lanes[MAX_PACKET_WIDTH];
+				FixedRay fixedLanes[MAX_PACKET_WIDTH];
+				RayCaster::TracePacket(map, table, cam, x, lanes);
+				FixedCaster::TracePacket(map, fixedTable, cam, x, fixedLanes);
+
+				for (int i=0; i<packet; ++i) {
+					Ray plain;
+					RayCaster::Setup(table, cam, x + i, plain);
+					StepRay(map, plain);
+
+					FixedRay fixedPlain;
+					FixedCaster::Setup(fixedTable, cam, x + i, fixedPlain);
+					StepRay(map, fixedPlain);
+
+					rays += 2;
+					bad += !SameRay(map, lanes[i], plain) + !SameRay(map, fixedLanes[i], fixedPlain);
+				}
+			}
+		}
+	}
+
+	std::ostringstream what;
+	what << "rays: " << rays << " traced against a plain DDA";
+	return Report(what.str(), bad, "differ");
+}
+
+bool SelfTest::CheckDistanceField(std::mt19937 &random) {
+	Map map(SELFTEST_MAP, nullptr);
+
+	int bad = EditAtRandom(SELFTEST_EDITS, false,
+		[&](int) { ToggleWall(map, random); },
+		[&]() {
+			const sf::Uint8 *field = map.GetDistanceField();
+			int wrong = 0;
+
+			for (int y=0; y<map.GetHeight(); ++y)
+				for (int x=0; x<map.GetWidth(); ++x)
+					wrong += field[y*map.GetFieldStride() + x] != GetWallDistance(map, x, y);
+
+			return wrong;
+		});
+
+	std::ostringstream what;
+	what << "distance field: " << SELFTEST_EDITS << " edits";
+	return Report(what.str(), bad, "cell(s) differ from a full rebuild");
+}
+
+bool SelfTest::CheckDoors(std::mt19937 &random) {
+	Map map(SELFTEST_MAP, nullptr);
+
+	int width = map.GetWidth();
+	int height = map.GetHeight();
+
+	// the map's doors and a few more in its inner walls
+	std::vector<int> doors;
+	for (int y=1; y<height-1; ++y) {
+		for (int x=1; x<width-1; ++x) {
+			Wall wall = map.Get(x, y);
+
+			if (wall.value && !map.IsDoor(x, y) && random()%20 == 0) {
+				wall.flags |= (int)WallFlags::DOOR;
+				map.Set(x, y, wall);
+			}
+
+			if (map.IsDoor(x, y))
+				doors.push_back(y*width + x);
+		}
+	}
+
+	std::set<int> open;
+	std::map<int, float> moving;
+
+	// each edit a tick, now and then with a door opened (again, if it is open or moving already:
+	// it starts over), and the doors checked after every one
+	int bad = EditAtRandom(SELFTEST_EDITS, true,
+		[&](int) {
+			if (random()%4 == 0) {
+				int p = doors[random()%doors.size()];
+				map.OpenDoor(p);
+				moving[p] = 0.f;
+			}
+
+			float dt = (1 + random()%10)/50.f;
+			map.Tick(dt);
+
+			for (auto itr = moving.begin(); itr != moving.end();) {
+				itr->second += dt;
+
+				if (itr->second >= 1.f) {
+					open.insert(itr->first);
+					itr = moving.erase(itr);
+				} else
+					++itr;
+			}
+		},
+		[&]() {
+			int wrong = 0;
+
+			for (int p : doors) {
+				float amount = -1.f;
+				bool isMoving = map.IsMoving(p, amount);
+				bool collide = (map.Get(p).flags & (int)WallFlags::COLLIDE) != 0 && !open.count(p);
+
+				if (map.IsOpen(p) != (open.count(p) > 0) || isMoving != (moving.count(p) > 0) || (isMoving && amount != moving[p]) || map.GetCollide(p) != collide)
+					wrong++;
+			}
+
+			return wrong;
+		});
+
+	std::ostringstream what;
+	what << "doors: " << doors.size() << " door(s) over " << SELFTEST_EDITS << " ticks";
+	return Report(what.str(), bad, "state(s) differ");
+}
+
+bool SelfTest::CheckPlanes(std::mt19937 &random) {
+	Map map(SELFTEST_MAP, nullptr);
+
+	int width = map.GetWidth();
+	int height = map.GetHeight();
+	int stride = map.GetFieldStride();
+
+	int bad = EditAtRandom(SELFTEST_EDITS, false,
+		[&](int e) {
+			// any cell, the outer wall included
+			map.Set(random()%(width*height), GetRandomWall(random));
+
+			// and a door or two opened among them
+			if (e%10 == 0) {
+				for (int p=0; p<width*height; ++p)
+					if (map.IsDoor(p) && random()%2)
+						map.OpenDoor(p);
+			}
+
+			map.Tick(0.1f);
+		},
+		[&]() {
+			const sf::Uint8 *field = map.GetDistanceField();
+			int wrong = 0;
+
+			for (int y=-1; y<=height; ++y) {
+				for (int x=-1; x<=width; ++x) {
+					// the border reads as wall, a cell wide all round
+					if (!map.IsInside(x, y)) {
+						wrong += !map.IsWall(x, y) || field[y*stride + x] != 0;
+						continue;
+					}
+
+					int p = y*width + x;
+					Wall wall = map.Get(p);
+					bool door = (wall.flags & (int)WallFlags::DOOR) != 0;
+					bool collide = (wall.flags & (int)WallFlags::COLLIDE) != 0 && !(door && map.IsOpen(p));
+
+					wrong += map.IsWall(x, y) != (wall.value != 0) || map.IsWall(p) != (wall.value != 0) || map.IsDoor(p) != door || map.GetCollide(p) != collide
+						|| map.GetFaceTexture(p, 0) != (int)wall.north || map.GetFaceTexture(p, 1) != (int)wall.east
+						|| map.GetFaceTexture(p, 2) != (int)wall.south || map.GetFaceTexture(p, 3) != (int)wall.west;
+				}
+			}
+
+			return wrong;
+		});
+
+	std::ostringstream what;
+	what << "planes: " << SELFTEST_EDITS << " edits";
+	return Report(what.str(), bad, "cell(s) differ from the packed cells");
+}
+
+bool SelfTest::CheckVisibleSet(std::mt19937 &random) {
+	Map map(SELFTEST_MAP, nullptr);
+	RayTable table;
+
+	int width = map.GetWidth();
+	int height = map.GetHeight();
+	int rays = 0;
+
+	// the map's own sets, and sets on blocks as a large map gets, kept up alongside them
+	VisibleSet blocks;
+	blocks.Build(map, SELFTEST_BLOCK_SQUARES);
+
+	int bad = EditAtRandom(SELFTEST_EDITS, false,
+		[&](int) {
+			int p = GetRandomCell(map, random);
+			bool blocked = map.BlocksSight(p);
+
+			map.Set(p, map.IsDoor(p) ? map.Get(p) : map.IsWall(p) ? Wall() : map.Get(0));
+			if (map.BlocksSight(p) != blocked)
+				blocks.Invalidate(map, p);
+		},
+		[&]() {
+			// the sets the edits left stale rebuilt, so those are what get looked at
+			while (map.GetVisibleSet().GetStaleCount() > 0)
+				map.Tick(0.f);
+			while (blocks.Refresh());
+
+			int wrong = 0;
+			for (int c=0; c<SELFTEST_VISIBLE_CAMERAS; ++c) {
+				sf::Vector2f pos(1.f + random()%((width - 2)*100)/100.f, 1.f + random()%((height - 2)*100)/100.f);
+				float angle = random()%3600/10.f*PI/180.f;
+				Camera cam(pos, sf::Vector2f(std::cos(angle), std::sin(angle)), FOV*PI/180.f);
+
+				if (map.IsWall((int)pos.x, (int)pos.y))
+					continue;
+
+				int from = (int)pos.y*width + (int)pos.x;
+				table.Update(cam, SELFTEST_COLUMNS, FOG_MAX_DISTANCE);
+
+				for (int x=0; x<SELFTEST_COLUMNS; ++x) {
+					Ray ray;
+					RayCaster::Setup(table, cam, x, ray);
+					StepRay(map, ray, [&](int cellX, int cellY) {
+						int to = cellY*width + cellX;
+						wrong += !map.CanSee(from, to) + !blocks.CanSee(from, to);
+					});
+
+					rays++;
+				}
+			}
+
+			return wrong;
+		});
+
+	std::ostringstream what;
+	what << "visible sets: " << rays << " plain DDA rays, on cells and on " << blocks.GetBlockSize() << "x" << blocks.GetBlockSize() << " blocks, over " << SELFTEST_EDITS << " edits";
+	return Report(what.str(), bad, "cell(s) seen that a set leaves out");
+}
+
+// the same cells, the planes and field made from them, and what else the file holds
+static bool SameMap(const Map &a, const Map &b) {
+	if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight() || a.GetTexWidth() != b.GetTexWidth() || a.GetTexHeight() != b.GetTexHeight()
+		|| a.GetFloorColor() != b.GetFloorColor() || a.GetCeilingColor() != b.GetCeilingColor()
+		|| a.GetFloorTexture() != b.GetFloorTexture() || a.GetCeilingTexture() != b.GetCeilingTexture() || a.HasDoors() != b.HasDoors())
+		return false;
+
+	for (int y=-1; y<=a.GetHeight(); ++y)
+		for (int x=-1; x<=a.GetWidth(); ++x)
+			if (a.IsWall(x, y) != b.IsWall(x, y))
+				return false;
+
+	for (int p=0; p<a.GetWidth()*a.GetHeight(); ++p) {
+		if (a.Get(p).value != b.Get(p).value || a.IsWall(p) != b.IsWall(p) || a.IsDoor(p) != b.IsDoor(p) || a.GetCollide(p) != b.GetCollide(p))
+			return false;
+
+		for (int side=0; side<4; ++side)
+			if (a.GetFaceTexture(p, side) != b.GetFaceTexture(p, side))
+				return false;
+	}
+
+	int field = a.GetFieldStride()*(a.GetHeight() + 1) - 1;
+	return std::equal(a.GetDistanceField() - a.GetFieldStride() - 1, a.GetDistanceField() + field, b.GetDistanceField() - b.GetFieldStride() - 1);
+}
+
+static std::vector<char> ReadFile(const std::string &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const std::string &filename, const std::vector<char> &data) {
+	std::ofstream file(filename, std::ios::binary);
+	file.write(data.data(), data.size());
+}
+
+bool SelfTest::CheckMapFile(std::mt19937 &random, bool compressed) {
+	Map map(SELFTEST_MAP, nullptr);
+
+	// everything the header holds set away from the defaults, and cells the file does not have
+	map.SetTexture(SELFTEST_TEXTURE, SELFTEST_TILE_SIZE, SELFTEST_TILE_SIZE);
+	map.SetFloorTexture(SELFTEST_FLOOR);
+	map.SetCeilingTexture(SELFTEST_CEILING);
+
+	EditAtRandom(20, false,
+		[&](int) { map.Set(random()%(map.GetWidth()*map.GetHeight()), GetRandomWall(random)); },
+		[]() { return 0; });
+
+	map.Save(SELFTEST_FILE, compressed);
+	Map saved(SELFTEST_FILE, nullptr);
+	Map loaded(SELFTEST_FILE, nullptr);
+	Map edited(SELFTEST_FILE, nullptr);
+	bool ok = SameMap(map, saved);
+
+	// edits keep up planes that are a raw file's pages as they do built ones
+	int edits = EditAtRandom(20, true,
+		[&](int) {
+			int p = random()%(map.GetWidth()*map.GetHeight());
+			Wall wall = GetRandomWall(random);
+			map.Set(p, wall);
+			edited.Set(p, wall);
+		},
+		[&]() { return (int)!SameMap(map, edited); });
+	ok = edits == 0 && ok;
+
+	// the damaged files are cut from a save that differs in every part, so anything taken from
+	// them before they are refused shows. the visible sets are the last thing in a file without
+	// entities
+	map.SetFloorTexture(SELFTEST_CEILING);
+	map.SetCeilingTexture(SELFTEST_FLOOR);
+	for (int p=0; p<map.GetWidth()*map.GetHeight(); ++p)
+		map.Set(p, Wall(~map.Get(p).value));
+
+	size_t size = ReadFile(SELFTEST_FILE).size();
+	map.Save(SELFTEST_DAMAGED_FILE, compressed);
+
+	std::vector<char> file = ReadFile(SELFTEST_DAMAGED_FILE);
+	std::vector<std::vector<char> > damaged;
+
+	damaged.push_back(file);
+	damaged.back()[0] ^= 0x20;
+
+	// cut short, the visible sets lose their last byte
+	damaged.push_back(file);
+	damaged.back().pop_back();
+
+	// a gap in the solid border the stored planes start with
+	if (!compressed) {
+		sf::Uint64 planes;
+		std::memcpy(&planes, file.data() + SELFTEST_PLANE_OFFSET, sizeof(planes));
+
+		damaged.push_back(file);
+		damaged.back()[planes] = 0;
+	}
+
+	// the first token of the last chunk made a varint that never ends
+	if (compressed) {
+		int cells = map.GetWidth()*map.GetHeight();
+		int first = (cells - 1)/MAP_CHUNK_CELLS*MAP_CHUNK_CELLS;
+
+		std::vector<sf::Uint32> last;
+		for (int p=first; p<cells; ++p)
+			last.push_back(map.Get(p).value);
+
+		std::vector<char> coded;
+		CellCodec::Encode(last.data(), (int)last.size(), coded);
+
+		size_t at = std::search(file.begin(), file.end(), coded.begin(), coded.end()) - file.begin();
+		ok = at < file.size() && ok;
+
+		if (at < file.size()) {
+			damaged.push_back(file);
+			std::fill(damaged.back().begin() + at, damaged.back().begin() + at + 5, (char)0xFF);
+		}
+	}
+
+	// written apart, the loaded map may be reading the good one's pages
+	int refused = 0;
+	for (const std::vector<char> &data : damaged) {
+		WriteFile(SELFTEST_DAMAGED_FILE, data);
+
+		try {
+			loaded.Load(SELFTEST_DAMAGED_FILE);
+		} catch (const std::runtime_error &) {
+			refused++;
+		}
+
+		ok = SameMap(saved, loaded) && ok;
+	}
+
+	// and one that is not there at all
+	std::remove(SELFTEST_DAMAGED_FILE);
+	try {
+		loaded.Load(SELFTEST_DAMAGED_FILE);
+	} catch (const std::runtime_error &) {
+		refused++;
+	}
+
+	ok = SameMap(saved, loaded) && ok;
+	std::remove(SELFTEST_FILE);
+
+	// saving where nothing can be written throws too
+	bool unsaved = false;
+	try {
+		map.Save(SELFTEST_UNWRITABLE_FILE, compressed);
+	} catch (const std::runtime_error &) {
+		unsaved = true;
+	}
+
+	int expected = (int)damaged.size() + 1;
+	std::ostringstream what;
+	what << (compressed ? "compressed" : "raw") << " save: " << size << " bytes, loaded back, " << refused << " of " << expected << " damaged file(s) refused, "
+		<< (unsaved ? "unwritable save refused" : "unwritable save went through");
+	return Report(what.str(), !ok + !unsaved + expected - refused, "check(s) failed");
+}
\ No newline at end of file
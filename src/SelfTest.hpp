@@ -0,0 +1,40 @@
+#pragma once
+
+#include <random>
+#include <string>
+
+class Map;
+
+// checks the map's own structures against plain models of them, headless, no frames drawn
+class SelfTest {
+public:
+	// returns true if every check passed
+	static bool Run();
+
+private:
+	// random rays traced with the leaps, float and fixed, a ray at a time and in packets, against
+	// a plain DDA that steps every cell, on the map and again with most of its walls taken out
+	static bool CheckRays(std::mt19937 &random);
+
+	// the distance field Set keeps up around each edit against one worked out from scratch
+	static bool CheckDistanceField(std::mt19937 &random);
+
+	// doors opened at random while the map ticks, their state against a model kept in a set of
+	// the open ones and a map of how far the moving ones have slid
+	static bool CheckDoors(std::mt19937 &random);
+
+	// the solidity bitmap, flags and face planes (and the borders around the bitmap and the
+	// distance field) against the packed cells, through random edits
+	static bool CheckPlanes(std::mt19937 &random);
+
+	// every cell random plain DDA rays pass through against the camera cell's visible set, the
+	// map's and one worked out on blocks, before random edits and after Set and Refresh
+	static bool CheckVisibleSet(std::mt19937 &random);
+
+	// the map with a few edits saved, loaded back and compared, then damaged copies of the file
+	// that have to be refused while the map loaded before stays as it was
+	static bool CheckMapFile(std::mt19937 &random, bool compressed);
+
+	// print what was checked and how many things were wrong, true if none were
+	static bool Report(const std::string &what, int bad, const std::string &wrong);
+};
\ No newline at end of file
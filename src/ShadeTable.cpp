@@ -0,0 +1,21 @@
+#include "ShadeTable.hpp"
+
+sf::Uint8 ShadeTable::m_Table[2][256][256];
+bool ShadeTable::m_Built = ShadeTable::Build();
+
+const sf::Uint8 *ShadeTable::Get(int mod, bool side) {
+	return m_Table[side ? 1 : 0][mod];
+}
+
+bool ShadeTable::Build() {
+	for (int mod=0; mod<256; ++mod) {
+		for (int v=0; v<256; ++v) {
+			int c = v*mod/255;
+
+			m_Table[0][mod][v] = (sf::Uint8)c;
+			m_Table[1][mod][v] = (sf::Uint8)(c*SHADE_SIDE/255);
+		}
+	}
+
+	return true;
+}
\ No newline at end of file
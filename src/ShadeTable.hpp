@@ -0,0 +1,29 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#define SHADE_SIDE 170
+
+// distance fog and the y-side darkening baked into one lookup per colour channel,
+// giving the same result as multiplying by sf::Color(mod, mod, mod) and then sf::Color(170, 170, 170)
+class ShadeTable {
+public:
+	// 256 entries mapping a channel value to its shaded value
+	static const sf::Uint8 *Get(int mod, bool side);
+
+	// shade the colour channels of a packed pixel, alpha is kept
+	static sf::Uint32 Apply(sf::Uint32 pixel, const sf::Uint8 *shade) {
+		sf::Uint8 *b = (sf::Uint8 *)&pixel;
+		b[0] = shade[b[0]];
+		b[1] = shade[b[1]];
+		b[2] = shade[b[2]];
+
+		return pixel;
+	}
+
+private:
+	static bool			Build();
+
+	static sf::Uint8	m_Table[2][256][256];
+	static bool			m_Built;
+};
\ No newline at end of file
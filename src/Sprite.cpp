@@ -3,16 +3,16 @@
 
 #define PI 3.14159265359f
 
-Sprite::Sprite(sf::Texture *tex, const sf::Vector2u &size, const sf::Vector2f &pos, float scale, float floatheight, bool directional)
-	: m_Position(pos), m_Scale(scale), m_FloatHeight(floatheight), m_Animated(false), m_Texture(tex),
-	m_Size(size), m_Directional(directional), m_Direction(0), m_Forward(sf::Vector2f(0.f, -1.f))
+Sprite::Sprite(SpriteSheet *sheet, const sf::Vector2f &pos, float scale, float floatheight, bool directional)
+	: m_Position(pos), m_Scale(scale), m_FloatHeight(floatheight), m_Animated(false), m_Sheet(sheet),
+	m_Directional(directional), m_Direction(0), m_Forward(sf::Vector2f(0.f, -1.f))
 {
 	
 }
 
-Sprite::Sprite(sf::Texture *tex, const Animation<int> &anim, const sf::Vector2u &size, const sf::Vector2f &pos, float scale, float floatheight, bool directional)
-	: m_Position(pos), m_Scale(scale), m_FloatHeight(floatheight), m_Animated(true), m_Texture(tex),
-	m_Anim(anim), m_Size(size), m_Directional(directional), m_Direction(0), m_Forward(sf::Vector2f(0.f, -1.f))
+Sprite::Sprite(SpriteSheet *sheet, const Animation<int> &anim, const sf::Vector2f &pos, float scale, float floatheight, bool directional)
+	: m_Position(pos), m_Scale(scale), m_FloatHeight(floatheight), m_Animated(true), m_Sheet(sheet),
+	m_Anim(anim), m_Directional(directional), m_Direction(0), m_Forward(sf::Vector2f(0.f, -1.f))
 {
 	m_Anim.Play();
 }
@@ -58,11 +58,7 @@ float Sprite::GetFloatHeight() const {
 }
 
 const sf::Vector2u &Sprite::GetSize() const {
-	return m_Size;
-}
-
-void Sprite::SetSize(const sf::Vector2u &s) {
-	m_Size = s;
+	return m_Sheet->GetFrameSize();
 }
 
 bool Sprite::IsAnimated() const {
@@ -81,36 +77,53 @@ void Sprite::SetDirectional(bool b) {
 	m_Directional = true;
 }
 
-const sf::Texture *Sprite::GetTexture() const {
-	return m_Texture;
+SpriteSheet *Sprite::GetSpriteSheet() const {
+	return m_Sheet;
 }
 
-void Sprite::SetTexture(sf::Texture *t) {
-	m_Texture = t;
+void Sprite::SetSpriteSheet(SpriteSheet *sheet) {
+	m_Sheet = sheet;
 }
 
-sf::IntRect Sprite::GetTextureRect() {
-	sf::IntRect r(0, 0, m_Size.x, m_Size.y);
+sf::IntRect Sprite::GetTextureRect(int level) {
+	int column = 0;
+	int row = 0;
 
 	if (m_Animated)
-		r.left = m_Size.x*(m_Anim.GetCurrentFrame()-1);
+		column = m_Anim.GetCurrentFrame()-1;
 
 	if (m_Directional)
-		r.top = m_Size.y*m_Direction;
+		row = m_Direction;
 
-	return r;
+	return m_Sheet->GetFrameRect(column, row, level);
 }
 
-void Sprite::SetViewerPosition(const sf::Vector2f &pos) {
-	if (m_Directional) {
-		sf::Vector2f d = pos - m_Position;
-		float mag = std::sqrt(std::pow(d.x, 2.f) + std::pow(d.y, 2.f))+0.0000001f;
+sf::IntRect Sprite::GetTextureRect(int level, const sf::Vector2f &viewer) const {
+	int column = 0;
+	int row = 0;
 
-		float dot = (d.x*m_Forward.x + d.y*m_Forward.y)/mag;
-		float cross = d.x*m_Forward.y - d.y*m_Forward.x;
-		cross = -cross/std::abs(cross);
+	if (m_Animated)
+		column = m_Anim.GetCurrentFrame()-1;
 
-		float ang = cross*std::acos(dot) + PI;
-		m_Direction = int(8.f*(ang+PI/8)/(2.f*PI))%8;
-	}
+	if (m_Directional)
+		row = GetDirection(viewer);
+
+	return m_Sheet->GetFrameRect(column, row, level);
 }
+
+void Sprite::SetViewerPosition(const sf::Vector2f &pos) {
+	if (m_Directional)
+		m_Direction = GetDirection(pos);
+}
+
+int Sprite::GetDirection(const sf::Vector2f &viewer) const {
+	sf::Vector2f d = viewer - m_Position;
+	float mag = std::sqrt(std::pow(d.x, 2.f) + std::pow(d.y, 2.f))+0.0000001f;
+
+	float dot = (d.x*m_Forward.x + d.y*m_Forward.y)/mag;
+	float cross = d.x*m_Forward.y - d.y*m_Forward.x;
+	cross = -cross/std::abs(cross);
+
+	float ang = cross*std::acos(dot) + PI;
+	return int(8.f*(ang+PI/8)/(2.f*PI))%8;
+}
\ No newline at end of file
@@ -2,11 +2,12 @@
 
 #include <SFML/Graphics.hpp>
 #include "Animation.hpp"
+#include "SpriteSheet.hpp"
 
 class Sprite {
 public:
-	Sprite(sf::Texture *tex, const sf::Vector2u &size, const sf::Vector2f &pos, float scale, float floatheight, bool directional=false);
-	Sprite(sf::Texture *tex, const Animation<int> &anim, const sf::Vector2u &size, const sf::Vector2f &pos, float scale, float floatheight, bool directional=false);
+	Sprite(SpriteSheet *sheet, const sf::Vector2f &pos, float scale, float floatheight, bool directional=false);
+	Sprite(SpriteSheet *sheet, const Animation<int> &anim, const sf::Vector2f &pos, float scale, float floatheight, bool directional=false);
 
 	virtual ~Sprite();
 
@@ -21,8 +22,7 @@ public:
 	void					SetFloatHeight(float);
 	float					GetFloatHeight() const;
 
-	const sf::Vector2u		&GetSize() const;	
-	void					SetSize(const sf::Vector2u &);
+	const sf::Vector2u		&GetSize() const;
 
 	bool					IsAnimated() const;
 	bool					IsDirectional() const;
@@ -30,24 +30,29 @@ public:
 
 	void					SetDirectional(bool b);
 
-	const sf::Texture		*GetTexture() const;
-	void					SetTexture(sf::Texture *tex);
-	sf::IntRect				GetTextureRect();
+	SpriteSheet				*GetSpriteSheet() const;
+	void					SetSpriteSheet(SpriteSheet *sheet);
+	sf::IntRect				GetTextureRect(int level=0);
+
+	// the frame as seen from viewer, without touching the sprite, so views can be drawn in parallel
+	sf::IntRect				GetTextureRect(int level, const sf::Vector2f &viewer) const;
 
 	void					SetViewerPosition(const sf::Vector2f &pos);
 
 	virtual void			Tick(float dt);
 
 protected:
+	// which of the 8 directional rows faces viewer
+	int						GetDirection(const sf::Vector2f &viewer) const;
+
 
-	sf::Texture		*m_Texture;
+	SpriteSheet		*m_Sheet;
 	int				m_Direction;
 
 	float			m_Scale;
 	float			m_FloatHeight;
 	sf::Vector2f	m_Position;
 	sf::Vector2f	m_Forward;
-	sf::Vector2u	m_Size;
 
 	bool			m_Animated;
 	bool			m_Directional;
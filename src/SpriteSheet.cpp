@@ -0,0 +1,196 @@
+#include "SpriteSheet.hpp"
+#include "FrameBuffer.hpp"
+#include "Palette.hpp"
+
+#include <algorithm>
+
+SpriteSheet::SpriteSheet(const sf::Image &image, const sf::Vector2u &frameSize)
+{
+	m_Frames = sf::Vector2u(image.getSize().x/frameSize.x, image.getSize().y/frameSize.y);
+
+	m_FrameSizes.push_back(frameSize);
+	m_Images.push_back(image);
+
+	// halve the frames until they are a single texel
+	sf::Vector2u size = frameSize;
+	while (size.x > 1 || size.y > 1) {
+		size = sf::Vector2u(std::max(1u, size.x/2), std::max(1u, size.y/2));
+		BuildLevel(image, size);
+	}
+
+	m_Textures.resize(m_Images.size(), nullptr);
+
+	// column-major copies so a screen column walks one contiguous strip
+	for (const sf::Image &level : m_Images) {
+		unsigned int w = level.getSize().x;
+		unsigned int h = level.getSize().y;
+		std::vector<sf::Uint32> texels(w*h);
+
+		for (unsigned int x=0; x<w; ++x)
+			for (unsigned int y=0; y<h; ++y)
+				texels[x*h + y] = PackColor(level.getPixel(x, y));
+
+		m_Texels.push_back(texels);
+
+		// and quantized for the 8-bit pipeline, when it is in use
+		if (Palette::IsEnabled()) {
+			std::vector<sf::Uint8> indices(w*h);
+			for (unsigned int i=0; i<w*h; ++i)
+				indices[i] = Palette::Match(texels[i]);
+
+			m_Indices.push_back(indices);
+		}
+	}
+
+	for (int level=0; level<GetLevelCount(); ++level)
+		BuildPosts(level);
+}
+
+SpriteSheet::~SpriteSheet() {
+	for (auto texture : m_Textures)
+		delete texture;
+}
+
+void SpriteSheet::BuildLevel(const sf::Image &source, const sf::Vector2u &size) {
+	const sf::Vector2u &full = m_FrameSizes[0];
+
+	sf::Image level;
+	level.create(m_Frames.x*size.x, m_Frames.y*size.y, sf::Color::Transparent);
+
+	for (unsigned int fy=0; fy<m_Frames.y; ++fy) {
+		for (unsigned int fx=0; fx<m_Frames.x; ++fx) {
+			for (unsigned int y=0; y<size.y; ++y) {
+				for (unsigned int x=0; x<size.x; ++x) {
+					// box filter the source texels this one covers, weighted by alpha so
+					// transparent texels don't darken the edges
+					unsigned int x0 = x*full.x/size.x, x1 = (x+1)*full.x/size.x;
+					unsigned int y0 = y*full.y/size.y, y1 = (y+1)*full.y/size.y;
+					unsigned int r = 0, g = 0, b = 0, a = 0, n = 0;
+
+					for (unsigned int sy=y0; sy<y1; ++sy) {
+						for (unsigned int sx=x0; sx<x1; ++sx) {
+							sf::Color c = source.getPixel(fx*full.x + sx, fy*full.y + sy);
+							r += c.r*c.a;
+							g += c.g*c.a;
+							b += c.b*c.a;
+							a += c.a;
+							n++;
+						}
+					}
+
+					sf::Color c = sf::Color::Transparent;
+					if (a > 0)
+						c = sf::Color(r/a, g/a, b/a, a/n);
+
+					level.setPixel(fx*size.x + x, fy*size.y + y, c);
+				}
+			}
+		}
+	}
+
+	m_FrameSizes.push_back(size);
+	m_Images.push_back(level);
+}
+
+void SpriteSheet::BuildPosts(int level) {
+	const std::vector<sf::Uint32> &texels = m_Texels[level];
+	unsigned int w = m_Images[level].getSize().x;
+	unsigned int h = m_Images[level].getSize().y;
+	unsigned int frameHeight = m_FrameSizes[level].y;
+
+	std::vector<SpritePost> posts;
+	std::vector<int> start;
+
+	bool translucent = false;
+	for (sf::Uint32 texel : texels) {
+		sf::Uint8 alpha = ((const sf::Uint8 *)&texel)[3];
+		translucent = translucent || (alpha > 0 && alpha < 255);
+	}
+
+	// runs never cross from one frame into the one below
+	for (unsigned int x=0; x<w; ++x) {
+		for (unsigned int row=0; row<m_Frames.y; ++row) {
+			start.push_back((int)posts.size());
+
+			const sf::Uint32 *column = &texels[x*h + row*frameHeight];
+			unsigned int y = 0;
+
+			while (y < frameHeight) {
+				while (y < frameHeight && ((const sf::Uint8 *)&column[y])[3] == 0)
+					y++;
+
+				unsigned int top = y;
+				while (y < frameHeight && ((const sf::Uint8 *)&column[y])[3] != 0)
+					y++;
+
+				if (y > top) {
+					SpritePost post;
+					post.top = (sf::Uint16)top;
+					post.length = (sf::Uint16)(y - top);
+					posts.push_back(post);
+				}
+			}
+		}
+	}
+
+	start.push_back((int)posts.size());
+
+	m_Posts.push_back(posts);
+	m_PostStart.push_back(start);
+	m_Translucent.push_back(translucent);
+}
+
+int SpriteSheet::GetLevelCount() const {
+	return (int)m_Images.size();
+}
+
+const sf::Vector2u &SpriteSheet::GetFrameSize(int level) const {
+	return m_FrameSizes[level];
+}
+
+const sf::Image &SpriteSheet::GetImage(int level) const {
+	return m_Images[level];
+}
+
+const sf::Uint32 *SpriteSheet::GetColumn(int x, int level) const {
+	return &m_Texels[level][x*m_Images[level].getSize().y];
+}
+
+const sf::Uint8 *SpriteSheet::GetIndexColumn(int x, int level) const {
+	return &m_Indices[level][x*m_Images[level].getSize().y];
+}
+
+const SpritePost *SpriteSheet::GetPosts(int x, int row, int level) const {
+	return m_Posts[level].data() + m_PostStart[level][x*m_Frames.y + row];
+}
+
+int SpriteSheet::GetPostCount(int x, int row, int level) const {
+	int i = x*m_Frames.y + row;
+	return m_PostStart[level][i+1] - m_PostStart[level][i];
+}
+
+bool SpriteSheet::IsTranslucent(int level) const {
+	return m_Translucent[level];
+}
+
+sf::Texture *SpriteSheet::GetTexture(int level) {
+	if (!m_Textures[level]) {
+		m_Textures[level] = new sf::Texture;
+		m_Textures[level]->loadFromImage(m_Images[level]);
+	}
+
+	return m_Textures[level];
+}
+
+int SpriteSheet::SelectLevel(float projectedHeight) const {
+	int level = 0;
+	while (level+1 < GetLevelCount() && m_FrameSizes[level+1].y >= projectedHeight)
+		level++;
+
+	return level;
+}
+
+sf::IntRect SpriteSheet::GetFrameRect(int column, int row, int level) const {
+	const sf::Vector2u &size = m_FrameSizes[level];
+	return sf::IntRect(column*size.x, row*size.y, size.x, size.y);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+// a run of texels with some coverage in one column of a frame, in texels from the frame's top
+struct SpritePost {
+	sf::Uint16	top;
+	sf::Uint16	length;
+};
+
+// a grid of equally sized sprite frames with a mip chain, every level keeps the same grid
+// with each frame filtered down on its own so frames never bleed into each other
+class SpriteSheet {
+public:
+	SpriteSheet(const sf::Image &image, const sf::Vector2u &frameSize);
+	~SpriteSheet();
+
+	int GetLevelCount() const;
+	const sf::Vector2u &GetFrameSize(int level=0) const;
+	const sf::Image &GetImage(int level=0) const;
+
+	// column x of the whole sheet at the given level as packed pixels, top to bottom
+	const sf::Uint32 *GetColumn(int x, int level=0) const;
+
+	// the same column as indices into the shared Palette, any coverage counts as opaque. only
+	// there if the palette was enabled when the sheet was made
+	const sf::Uint8 *GetIndexColumn(int x, int level=0) const;
+
+	// the opaque runs of column x of the frames on grid row `row`, top to bottom,
+	// everything between them is fully transparent
+	const SpritePost *GetPosts(int x, int row, int level=0) const;
+	int GetPostCount(int x, int row, int level=0) const;
+
+	// if the level has texels neither fully opaque nor fully transparent
+	bool IsTranslucent(int level) const;
+
+	// uploaded on first use, needs a GL context
+	sf::Texture *GetTexture(int level=0);
+
+	// the smallest level still at least projectedHeight texels tall
+	int SelectLevel(float projectedHeight) const;
+
+	// frame (column, row) of the grid at the given level
+	sf::IntRect GetFrameRect(int column, int row, int level=0) const;
+
+private:
+	SpriteSheet(const SpriteSheet &);
+
+	void BuildLevel(const sf::Image &source, const sf::Vector2u &size);
+	void BuildPosts(int level);
+
+private:
+	sf::Vector2u				m_Frames;
+
+	std::vector<sf::Vector2u>	m_FrameSizes;
+	std::vector<sf::Image>		m_Images;
+
+	// the same levels stored column-major for the software renderer
+	std::vector<std::vector<sf::Uint32> >	m_Texels;
+	std::vector<std::vector<sf::Uint8> >	m_Indices;
+
+	// posts of every (column, grid row) back to back, with where each one's list starts
+	std::vector<std::vector<SpritePost> >	m_Posts;
+	std::vector<std::vector<int> >			m_PostStart;
+	std::vector<bool>						m_Translucent;
+
+	std::vector<sf::Texture *>	m_Textures;
+};
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(int threads)
+	: m_Job(nullptr), m_Count(0), m_Bands(0), m_NextBand(0), m_Busy(0), m_Generation(0), m_Quit(false)
+{
+	for (int i=1; i<threads; ++i)
+		m_Threads.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_WakeCond.notify_all();
+
+	for (auto &thread : m_Threads)
+		thread.join();
+}
+
+int ThreadPool::GetThreadCount() const {
+	return (int)m_Threads.size() + 1;
+}
+
+int ThreadPool::GetDefaultThreadCount() {
+	int n = (int)std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+void ThreadPool::ParallelFor(int count, int bands, const std::function<void(int, int)> &job) {
+	if (bands > count)
+		bands = count;
+
+	if (bands <= 0)
+		return;
+
+	// nothing to share, run it here
+	if (m_Threads.empty() || bands == 1) {
+		for (int b=0; b<bands; ++b)
+			job(count*b/bands, count*(b+1)/bands);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Job = &job;
+		m_Count = count;
+		m_Bands = bands;
+		m_NextBand = 0;
+		m_Busy = (int)m_Threads.size();
+		m_Generation++;
+	}
+	m_WakeCond.notify_all();
+
+	// the calling thread takes bands too
+	RunBands();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_DoneCond.wait(lock, [this]() { return m_Busy == 0; });
+	m_Job = nullptr;
+}
+
+void ThreadPool::WorkerLoop() {
+	unsigned int generation = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WakeCond.wait(lock, [this, generation]() { return m_Quit || m_Generation != generation; });
+
+			if (m_Quit)
+				return;
+
+			generation = m_Generation;
+		}
+
+		RunBands();
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (--m_Busy == 0)
+				m_DoneCond.notify_one();
+		}
+	}
+}
+
+void ThreadPool::RunBands() {
+	// bands are handed out first come first served, which balances uneven columns
+	int b;
+	while ((b = m_NextBand++) < m_Bands)
+		(*m_Job)(m_Count*b/m_Bands, m_Count*(b+1)/m_Bands);
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// persistent worker threads for splitting a frame's work into independent bands
+class ThreadPool {
+public:
+	// threads counts the calling thread too, so 1 runs everything inline
+	explicit ThreadPool(int threads);
+	~ThreadPool();
+
+	int GetThreadCount() const;
+
+	// split [0, count) into bands and call job(begin, end) for each, blocks until every band is done
+	void ParallelFor(int count, int bands, const std::function<void(int, int)> &job);
+
+	static int GetDefaultThreadCount();
+
+private:
+	ThreadPool(const ThreadPool &);
+
+	void WorkerLoop();
+	void RunBands();
+
+private:
+	std::vector<std::thread>				m_Threads;
+
+	std::mutex								m_Mutex;
+	std::condition_variable					m_WakeCond;
+	std::condition_variable					m_DoneCond;
+
+	const std::function<void(int, int)>		*m_Job;
+	int										m_Count;
+	int										m_Bands;
+	std::atomic<int>						m_NextBand;
+
+	int										m_Busy;
+	unsigned int							m_Generation;
+	bool									m_Quit;
+};
\ No newline at end of file
@@ -0,0 +1,356 @@
+#include "VisibleSet.hpp"
+#include "Map.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// how Write lays the sets out: the shifts, then the rows, then m_Open as 32-bit counts
+struct VisibleHeader {
+	sf::Uint32	blockShift;
+	sf::Uint32	clusterShift;
+};
+
+// which side of a line a point is on, > 0 for below it (the line passes above the point)
+static sf::Int64 RelativeSlope(int xi, int yi, int xf, int yf, int x, int y) {
+	return (sf::Int64)(yf - yi)*(xf - x) - (sf::Int64)(xf - xi)*(yf - y);
+}
+
+template<typename L>
+static sf::Int64 RelativeSlope(const L &line, int x, int y) {
+	return RelativeSlope(line.xi, line.yi, line.xf, line.yf, x, y);
+}
+
+VisibleSet::VisibleSet()
+	: m_MapWidth(0), m_BlockShift(0), m_Width(0), m_Height(0), m_Shift(0), m_ClustersX(0), m_RowWords(0), m_Stamp(0), m_Visits(0)
+{
+
+}
+
+// squares of 2^shift cells a side it takes to cover a map
+static int CountSquares(int size, int shift) {
+	return (int)(((sf::Int64)size + (1 << shift) - 1) >> shift);
+}
+
+void VisibleSet::Build(const Map &map, int maxSquares) {
+	int width = map.GetWidth();
+	int height = map.GetHeight();
+
+	m_MapWidth = width;
+	m_BlockShift = 0;
+	while ((sf::Int64)CountSquares(width, m_BlockShift)*CountSquares(height, m_BlockShift) > maxSquares)
+		m_BlockShift++;
+
+	m_Width = CountSquares(width, m_BlockShift);
+	m_Height = CountSquares(height, m_BlockShift);
+
+	m_Open.assign(m_Width*m_Height, 0);
+	for (int y=0; y<height; ++y)
+		for (int x=0; x<width; ++x)
+			m_Open[(y >> m_BlockShift)*m_Width + (x >> m_BlockShift)] += !map.BlocksSight(y*width + x);
+
+	// grow the clusters until a row per cluster fits the budget
+	m_RowWords = (m_Width*m_Height + 63)/64;
+	m_Shift = 0;
+	while (true) {
+		int clusters = CountSquares(m_Width, m_Shift)*CountSquares(m_Height, m_Shift);
+		if ((sf::Int64)clusters*m_RowWords*8 <= PVS_MAX_BYTES || clusters <= 1)
+			break;
+		m_Shift++;
+	}
+
+	Layout();
+
+	for (int c=0; c<(int)m_Stale.size(); ++c)
+		BuildRow(c);
+}
+
+void VisibleSet::Clear() {
+	*this = VisibleSet();
+}
+
+bool VisibleSet::IsEmpty() const {
+	return m_Rows.empty();
+}
+
+void VisibleSet::Layout() {
+	m_RowWords = (m_Width*m_Height + 63)/64;
+	m_ClustersX = CountSquares(m_Width, m_Shift);
+	int clusters = m_ClustersX*CountSquares(m_Height, m_Shift);
+
+	m_Rows.assign((size_t)clusters*m_RowWords, 0);
+	m_Stale.assign(clusters, 0);
+	m_StaleRows.clear();
+	m_Seen.assign(m_Width*m_Height, 0);
+	m_Stamp = 0;
+}
+
+void VisibleSet::Invalidate(const Map &map, int p) {
+	if (m_Open.empty())
+		return;
+
+	int s = ((p/m_MapWidth) >> m_BlockShift)*m_Width + ((p%m_MapWidth) >> m_BlockShift);
+	bool blocked = BlocksSight(s);
+	m_Open[s] += map.BlocksSight(p) ? -1 : 1;
+
+	// a block with an open cell left, or one that had one already, looks the same from anywhere
+	if (BlocksSight(s) == blocked)
+		return;
+
+	// a source that could not see the square never looked at it, so what it sees is the same
+	for (int c=0; c<(int)m_Stale.size(); ++c) {
+		if (!m_Stale[c] && ((m_Rows[(size_t)c*m_RowWords + (s >> 6)] >> (s & 63)) & 1)) {
+			m_Stale[c] = 1;
+			m_StaleRows.push_back(c);
+		}
+	}
+}
+
+bool VisibleSet::Refresh(int budget) {
+	m_Visits = 0;
+
+	while (!m_StaleRows.empty() && m_Visits < budget) {
+		int c = m_StaleRows.back();
+		m_StaleRows.pop_back();
+
+		BuildRow(c);
+		m_Stale[c] = 0;
+	}
+
+	return !m_StaleRows.empty();
+}
+
+bool VisibleSet::CanSee(int from, int to) const {
+	if (m_Rows.empty())
+		return true;
+
+	int shift = m_BlockShift + m_Shift;
+	int cluster = ((from/m_MapWidth) >> shift)*m_ClustersX + ((from%m_MapWidth) >> shift);
+	if (m_Stale[cluster])
+		return true;
+
+	int s = ((to/m_MapWidth) >> m_BlockShift)*m_Width + ((to%m_MapWidth) >> m_BlockShift);
+	return (m_Rows[(size_t)cluster*m_RowWords + (s >> 6)] >> (s & 63)) & 1;
+}
+
+int VisibleSet::GetClusterSize() const {
+	return 1 << (m_BlockShift + m_Shift);
+}
+
+int VisibleSet::GetBlockSize() const {
+	return 1 << m_BlockShift;
+}
+
+int VisibleSet::GetStaleCount() const {
+	return (int)m_StaleRows.size();
+}
+
+void VisibleSet::Write(std::vector<char> &data) const {
+	VisibleHeader header;
+	header.blockShift = (sf::Uint32)m_BlockShift;
+	header.clusterShift = (sf::Uint32)m_Shift;
+
+	std::vector<sf::Uint32> open(m_Open.begin(), m_Open.end());
+
+	data.insert(data.end(), (const char *)&header, (const char *)(&header + 1));
+	data.insert(data.end(), (const char *)m_Rows.data(), (const char *)(m_Rows.data() + m_Rows.size()));
+	data.insert(data.end(), (const char *)open.data(), (const char *)(open.data() + open.size()));
+}
+
+bool VisibleSet::Read(int width, int height, const char *data, size_t size) {
+	VisibleHeader header;
+	if (size < sizeof(header))
+		return false;
+
+	std::memcpy(&header, data, sizeof(header));
+	if (header.blockShift > 30 || header.clusterShift > 30)
+		return false;
+
+	// as many squares and clusters as the shifts make of the map, and nothing more in the data
+	sf::Uint64 squares = (sf::Uint64)CountSquares(width, header.blockShift)*CountSquares(height, header.blockShift);
+	sf::Uint64 clusters = (sf::Uint64)CountSquares(CountSquares(width, header.blockShift), header.clusterShift)*CountSquares(CountSquares(height, header.blockShift), header.clusterShift);
+	sf::Uint64 rows = clusters*((squares + 63)/64);
+	if (rows > (size - sizeof(header))/8 || squares*4 != size - sizeof(header) - rows*8)
+		return false;
+
+	m_MapWidth = width;
+	m_BlockShift = (int)header.blockShift;
+	m_Width = CountSquares(width, m_BlockShift);
+	m_Height = CountSquares(height, m_BlockShift);
+	m_Shift = (int)header.clusterShift;
+	Layout();
+
+	std::memcpy(m_Rows.data(), data + sizeof(header), (size_t)rows*8);
+
+	std::vector<sf::Uint32> open((size_t)squares);
+	std::memcpy(open.data(), data + sizeof(header) + rows*8, (size_t)squares*4);
+	m_Open.assign(open.begin(), open.end());
+
+	return true;
+}
+
+bool VisibleSet::BlocksSight(int square) const {
+	return m_Open[square] == 0;
+}
+
+void VisibleSet::BuildRow(int cluster) {
+	int x0 = (cluster%m_ClustersX) << m_Shift;
+	int y0 = (cluster/m_ClustersX) << m_Shift;
+	int x1 = std::min(m_Width, x0 + (1 << m_Shift));
+	int y1 = std::min(m_Height, y0 + (1 << m_Shift));
+
+	// stamps save clearing the scratch for every row
+	if (++m_Stamp == 0) {
+		std::fill(m_Seen.begin(), m_Seen.end(), 0);
+		m_Stamp = 1;
+	}
+	m_SeenCells.clear();
+
+	for (int y = y0; y < y1; y++)
+		for (int x = x0; x < x1; x++)
+			CastFrom(x, y);
+
+	sf::Uint64 *row = &m_Rows[(size_t)cluster*m_RowWords];
+	std::fill(row, row + m_RowWords, 0);
+
+	// every cell seen, and the cells around the empty ones
+	for (int p : m_SeenCells) {
+		int x = p%m_Width;
+		int y = p/m_Width;
+		int r = BlocksSight(p) ? 0 : 1;
+
+		for (int ny = std::max(0, y - r); ny <= std::min(m_Height - 1, y + r); ny++) {
+			for (int nx = std::max(0, x - r); nx <= std::min(m_Width - 1, x + r); nx++) {
+				int n = ny*m_Width + nx;
+				row[n >> 6] |= (sf::Uint64)1 << (n & 63);
+			}
+		}
+	}
+}
+
+void VisibleSet::CastFrom(int x, int y) {
+	See(y*m_Width + x);
+
+	// a quadrant at a time, mirrored so the lines always run up and to the right
+	CastQuadrant(x, y, 1, 1, m_Width - 1 - x, m_Height - 1 - y);
+	CastQuadrant(x, y, -1, 1, x, m_Height - 1 - y);
+	CastQuadrant(x, y, 1, -1, m_Width - 1 - x, y);
+	CastQuadrant(x, y, -1, -1, x, y);
+}
+
+// precise permissive field of view: the source is the square (0, 0)-(1, 1), each open wedge
+// of lines out of it is narrowed around the blocking cells it meets, diagonal by diagonal
+void VisibleSet::CastQuadrant(int x, int y, int dx, int dy, int extentX, int extentY) {
+	View view;
+	view.shallow = { 0, 1, extentX, 0 };
+	view.steep = { 1, 0, 0, extentY };
+	view.shallowBump = -1;
+	view.steepBump = -1;
+
+	m_Views.assign(1, view);
+	m_Bumps.clear();
+
+	for (int i = 1; i <= extentX + extentY && !m_Views.empty(); i++) {
+		size_t current = 0;
+
+		for (int j = std::max(i - extentX, 0); j <= std::min(i, extentY) && current < m_Views.size(); j++)
+			Visit(x, y, dx, dy, i - j, j, current);
+	}
+}
+
+void VisibleSet::Visit(int x, int y, int dx, int dy, int i, int j, size_t &current) {
+	int tlx = i, tly = j + 1;
+	int brx = i + 1, bry = j;
+
+	// the wedges run shallow to steep as the diagonal does, skip those the cell is above
+	while (current < m_Views.size() && RelativeSlope(m_Views[current].steep, brx, bry) >= 0)
+		current++;
+
+	if (current == m_Views.size() || RelativeSlope(m_Views[current].shallow, tlx, tly) <= 0)
+		return;
+
+	int p = (y + j*dy)*m_Width + (x + i*dx);
+	See(p);
+	m_Visits++;
+
+	if (!BlocksSight(p))
+		return;
+
+	View &view = m_Views[current];
+	bool belowShallow = RelativeSlope(view.shallow, brx, bry) < 0;
+	bool aboveSteep = RelativeSlope(view.steep, tlx, tly) > 0;
+
+	if (belowShallow && aboveSteep) {
+		// across the whole wedge, nothing gets past
+		m_Views.erase(m_Views.begin() + current);
+	} else if (belowShallow) {
+		AddShallowBump(tlx, tly, view);
+		CheckView(current);
+	} else if (aboveSteep) {
+		AddSteepBump(brx, bry, view);
+		CheckView(current);
+	} else {
+		// in the middle, the wedge splits into one either side
+		m_Views.insert(m_Views.begin() + current, view);
+
+		size_t steep = current + 1;
+		AddSteepBump(brx, bry, m_Views[current]);
+		if (!CheckView(current))
+			steep--;
+
+		AddShallowBump(tlx, tly, m_Views[steep]);
+		CheckView(steep);
+	}
+}
+
+void VisibleSet::AddShallowBump(int x, int y, View &view) {
+	view.shallow.xf = x;
+	view.shallow.yf = y;
+
+	m_Bumps.push_back({ x, y, view.shallowBump });
+	view.shallowBump = (int)m_Bumps.size() - 1;
+
+	// pivot on any corner the steep edge went around that the new edge would cut
+	for (int b = view.steepBump; b >= 0; b = m_Bumps[b].parent) {
+		if (RelativeSlope(view.shallow, m_Bumps[b].x, m_Bumps[b].y) < 0) {
+			view.shallow.xi = m_Bumps[b].x;
+			view.shallow.yi = m_Bumps[b].y;
+		}
+	}
+}
+
+void VisibleSet::AddSteepBump(int x, int y, View &view) {
+	view.steep.xf = x;
+	view.steep.yf = y;
+
+	m_Bumps.push_back({ x, y, view.steepBump });
+	view.steepBump = (int)m_Bumps.size() - 1;
+
+	for (int b = view.shallowBump; b >= 0; b = m_Bumps[b].parent) {
+		if (RelativeSlope(view.steep, m_Bumps[b].x, m_Bumps[b].y) > 0) {
+			view.steep.xi = m_Bumps[b].x;
+			view.steep.yi = m_Bumps[b].y;
+		}
+	}
+}
+
+bool VisibleSet::CheckView(size_t current) {
+	const Line &shallow = m_Views[current].shallow;
+	const Line &steep = m_Views[current].steep;
+
+	// a wedge closed down to a line out of a corner of the source holds nothing
+	bool collinear = RelativeSlope(shallow, steep.xi, steep.yi) == 0 && RelativeSlope(shallow, steep.xf, steep.yf) == 0;
+	if (collinear && (RelativeSlope(shallow, 0, 1) == 0 || RelativeSlope(shallow, 1, 0) == 0)) {
+		m_Views.erase(m_Views.begin() + current);
+		return false;
+	}
+
+	return true;
+}
+
+void VisibleSet::See(int p) {
+	if (m_Seen[p] == m_Stamp)
+		return;
+
+	m_Seen[p] = m_Stamp;
+	m_SeenCells.push_back(p);
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+class Map;
+
+// the most the sets of a map take, sources are grouped into square clusters until they fit
+#define PVS_MAX_BYTES (4 << 20)
+
+// building is quadratic in the squares the sets are worked out on, so larger maps group their
+// cells into square blocks until there are no more than this. a block blocks sight only if
+// every cell in it does
+#define PVS_MAX_SQUARES (128*128)
+
+// cells a Refresh may look at before it stops, a few milliseconds' worth
+#define PVS_REFRESH_VISITS (1 << 17)
+
+// potentially visible set: for each map cell, the cells that can be seen from anywhere in it
+// along a straight line through cells that do not block sight (walls, doors count as open).
+// worked out exactly, square to square, then grown by a cell around every empty cell seen, so
+// the walls whose faces show, grazing DDA steps and billboards reaching up to a cell out of
+// their own are all in it. never smaller than what can be seen, only ever a little larger.
+// on blocks, a block is seen from a block if any line between them does not cross a whole
+// blocking block, which any line between their cells passes
+class VisibleSet {
+public:
+	VisibleSet();
+
+	// squares of a cell each, or the smallest blocks that keep them within maxSquares
+	void Build(const Map &map, int maxSquares = PVS_MAX_SQUARES);
+
+	// no sets, every cell sees every other until the next Build or Read
+	void Clear();
+	bool IsEmpty() const;
+
+	// after cell p changed whether it blocks sight, only the sources that could see its square
+	// change, and only if the square changed whether it blocks. their sets are marked stale, and
+	// see everything until a Refresh gets round to them
+	void Invalidate(const Map &map, int p);
+
+	// rebuild stale sets until the budget runs out, true if any are left
+	bool Refresh(int budget = PVS_REFRESH_VISITS);
+
+	// if anything in cell `to` can be seen from cell `from`
+	bool CanSee(int from, int to) const;
+
+	// cells per side of a source cluster, 1 if every cell has its own set
+	int GetClusterSize() const;
+
+	// cells per side of the squares the sets are worked out on, 1 unless the map is large
+	int GetBlockSize() const;
+
+	// sources waiting for a Refresh
+	int GetStaleCount() const;
+
+	// the sets as a map file stores them, and back into sets for a map of that size. Read is
+	// false if the data does not fit one
+	void Write(std::vector<char> &data) const;
+	bool Read(int width, int height, const char *data, size_t size);
+
+private:
+	struct Line {
+		int		xi;
+		int		yi;
+		int		xf;
+		int		yf;
+	};
+
+	// a wedge of lines out of the source square, between its shallow and steep edges, and
+	// the corners each edge was bent around (indices into m_Bumps, -1 ends)
+	struct View {
+		Line	shallow;
+		Line	steep;
+		int		shallowBump;
+		int		steepBump;
+	};
+
+	struct Bump {
+		int		x;
+		int		y;
+		int		parent;
+	};
+
+	// size the clusters, rows and scratch for the squares
+	void Layout();
+
+	void BuildRow(int cluster);
+	void CastFrom(int x, int y);
+	void CastQuadrant(int x, int y, int dx, int dy, int extentX, int extentY);
+	void Visit(int x, int y, int dx, int dy, int i, int j, size_t &view);
+	bool BlocksSight(int square) const;
+
+	void AddShallowBump(int x, int y, View &view);
+	void AddSteepBump(int x, int y, View &view);
+	bool CheckView(size_t view);
+	void See(int p);
+
+private:
+	int						m_MapWidth;
+	int						m_BlockShift;	// log2 of the block size
+	int						m_Width;		// in squares
+	int						m_Height;
+	int						m_Shift;		// log2 of the cluster size, in squares
+	int						m_ClustersX;
+	int						m_RowWords;
+	std::vector<sf::Uint64>	m_Rows;
+	std::vector<sf::Uint8>	m_Stale;
+	std::vector<int>		m_StaleRows;
+
+	// cells of each square that do not block sight, it blocks if there are none
+	std::vector<int>		m_Open;
+
+	// scratch for one row: squares seen from the cluster (stamped) and the wedges still open
+	std::vector<unsigned>	m_Seen;
+	unsigned				m_Stamp;
+	int						m_Visits;
+	std::vector<int>		m_SeenCells;
+	std::vector<View>		m_Views;
+	std::vector<Bump>		m_Bumps;
+};
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "WallAtlas.hpp"
+#include "FrameBuffer.hpp"
+#include "Palette.hpp"
+
+WallAtlas::WallAtlas()
+	: m_TexWidth(0), m_TexHeight(0), m_Count(0)
+{
+
+}
+
+void WallAtlas::Create(const sf::Image &image, int texWidth, int texHeight) {
+	int across = image.getSize().x/texWidth;
+	int down = image.getSize().y/texHeight;
+
+	m_TexWidth = texWidth;
+	m_TexHeight = texHeight;
+	m_Count = across*down;
+
+	m_Levels.clear();
+	m_Levels.push_back(std::vector<sf::Uint32>(m_Count*texWidth*texHeight));
+
+	for (int n=0; n<m_Count; ++n) {
+		int left = (n%across)*texWidth;
+		int top = (n/across)*texHeight;
+
+		for (int u=0; u<texWidth; ++u) {
+			sf::Uint32 *column = &m_Levels[0][(n*texWidth + u)*texHeight];
+
+			for (int v=0; v<texHeight; ++v)
+				column[v] = PackColor(image.getPixel(left + u, top + v));
+		}
+	}
+
+	// each level averages 2x2 texels of the one above
+	int w = texWidth;
+	int h = texHeight;
+
+	while (w > 1 && h > 1) {
+		const std::vector<sf::Uint32> &src = m_Levels.back();
+		std::vector<sf::Uint32> dst(m_Count*(w/2)*(h/2));
+
+		for (int n=0; n<m_Count; ++n) {
+			for (int u=0; u<w/2; ++u) {
+				const sf::Uint32 *a = &src[(n*w + 2*u)*h];
+				const sf::Uint32 *b = &src[(n*w + 2*u + 1)*h];
+				sf::Uint32 *column = &dst[(n*(w/2) + u)*(h/2)];
+
+				for (int v=0; v<h/2; ++v) {
+					sf::Color c[4] = { UnpackColor(a[2*v]), UnpackColor(a[2*v + 1]), UnpackColor(b[2*v]), UnpackColor(b[2*v + 1]) };
+
+					column[v] = PackColor(sf::Color(
+						(c[0].r + c[1].r + c[2].r + c[3].r)/4,
+						(c[0].g + c[1].g + c[2].g + c[3].g)/4,
+						(c[0].b + c[1].b + c[2].b + c[3].b)/4,
+						(c[0].a + c[1].a + c[2].a + c[3].a)/4));
+				}
+			}
+		}
+
+		m_Levels.push_back(dst);
+		w /= 2;
+		h /= 2;
+	}
+
+	// every level quantized for the 8-bit pipeline, when it is in use
+	m_IndexLevels.clear();
+	if (!Palette::IsEnabled())
+		return;
+
+	for (const std::vector<sf::Uint32> &level : m_Levels) {
+		std::vector<sf::Uint8> indices(level.size() + PALETTE_GATHER_PAD);
+
+		for (size_t i=0; i<level.size(); ++i)
+			indices[i] = Palette::Match(level[i]);
+
+		m_IndexLevels.push_back(indices);
+	}
+}
+
+int WallAtlas::GetTextureCount() const {
+	return m_Count;
+}
+
+int WallAtlas::GetTexWidth() const {
+	return m_TexWidth;
+}
+
+int WallAtlas::GetTexHeight() const {
+	return m_TexHeight;
+}
+
+int WallAtlas::GetLevelCount() const {
+	return (int)m_Levels.size();
+}
+
+int WallAtlas::SelectLevel(int lineHeight) const {
+	int level = 0;
+	while (level+1 < GetLevelCount() && (m_TexHeight >> (level+1)) >= lineHeight)
+		level++;
+
+	return level;
+}
+
+const sf::Uint32 *WallAtlas::GetColumn(int n, int u, int level) const {
+	int w = m_TexWidth >> level;
+	int h = m_TexHeight >> level;
+
+	return &m_Levels[level][(n*w + u)*h];
+}
+
+const sf::Uint8 *WallAtlas::GetIndexColumn(int n, int u, int level) const {
+	int w = m_TexWidth >> level;
+	int h = m_TexHeight >> level;
+
+	return &m_IndexLevels[level][(n*w + u)*h];
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+// the wall texture sheet cut into separate textures, each stored column-major so a
+// screen column walks one contiguous strip of texels, with a mip chain down to 1x1
+class WallAtlas {
+public:
+	WallAtlas();
+
+	// cut a sheet of texWidth x texHeight textures, numbered left to right then top to bottom
+	void Create(const sf::Image &image, int texWidth, int texHeight);
+
+	int GetTextureCount() const;
+	int GetTexWidth() const;
+	int GetTexHeight() const;
+	int GetLevelCount() const;
+
+	// the smallest level still at least lineHeight texels tall
+	int SelectLevel(int lineHeight) const;
+
+	// texHeight >> level texels of column u of texture n at that level, top to bottom
+	const sf::Uint32 *GetColumn(int n, int u, int level=0) const;
+
+	// the same column as indices into the shared Palette, only there if it was enabled at Create
+	const sf::Uint8 *GetIndexColumn(int n, int u, int level=0) const;
+
+private:
+	int						m_TexWidth;
+	int						m_TexHeight;
+	int						m_Count;
+
+	std::vector<std::vector<sf::Uint32> >	m_Levels;
+	std::vector<std::vector<sf::Uint8> >	m_IndexLevels;
+};
\ No newline at end of file
@@ -1,9 +1,16 @@
 #include <SFML/Graphics.hpp>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <cstdlib>
 
 #include "Game.hpp"
 #include "Map.hpp"
+#include "GoldenTest.hpp"
+#include "SelfTest.hpp"
+#include "ThreadPool.hpp"
+#include "RayCaster.hpp"
+#include "Palette.hpp"
 
 #define MAP_WIDTH 28
 #define MAP_HEIGHT 20
@@ -11,12 +18,72 @@
 #define SCREEN_HEIGHT 450
 
 int main(int argc, char *argv[]) {
+	int threads = ThreadPool::GetDefaultThreadCount();
+	bool golden = false;
+	bool selfTest = false;
+	bool record = false;
+	float frameMs = 0.f;
+	WallMode walls = WallMode::DDA;
+	bool palettized = false;
+	bool fixedPoint = false;
+	float fog = FOG_DISTANCE;
+	int batch = 0;
+
+	for (int i=1; i<argc; ++i) {
+		std::string arg(argv[i]);
+
+		if (arg == "--golden")
+			golden = true;
+		else if (arg == "--golden-record")
+			golden = record = true;
+		else if (arg == "--selftest")
+			selfTest = true;
+		else if (arg == "--threads" && i+1 < argc)
+			threads = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--frame-ms" && i+1 < argc)
+			frameMs = std::max(0.f, (float)std::atof(argv[++i]));
+		else if (arg == "--batch" && i+1 < argc)
+			batch = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--palette") {
+			palettized = true;
+			Palette::SetEnabled(true);
+		}
+		else if (arg == "--fixed")
+			fixedPoint = true;
+		else if (arg == "--fog" && i+1 < argc)
+			fog = std::max(1.f, std::min(FOG_MAX_DISTANCE, (float)std::atof(argv[++i])));
+		else if (arg == "--walls" && i+1 < argc)
+			walls = std::string(argv[++i]) == "segments" ? WallMode::SEGMENTS : WallMode::DDA;
+		else if (arg == "--simd" && i+1 < argc) {
+			std::string mode(argv[++i]);
+
+			if (mode == "none")
+				RayCaster::SetMode(PacketMode::SCALAR);
+			else if (mode == "sse")
+				RayCaster::SetMode(PacketMode::SSE);
+			else if (mode == "avx2")
+				RayCaster::SetMode(PacketMode::AVX2);
+		}
+	}
+
+	// headless modes, no window is opened
+	if (selfTest)
+		return SelfTest::Run() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	if (golden)
+		return GoldenTest::Run(record, threads, walls, palettized, fixedPoint, batch, fog) ? EXIT_SUCCESS : EXIT_FAILURE;
+
 	sf::RenderWindow win(sf::VideoMode(SCREEN_WIDTH, SCREEN_HEIGHT), "Ray Caster");
 	win.setVerticalSyncEnabled(false);
 	win.setMouseCursorVisible(false);
 	win.setKeyRepeatEnabled(false);
 
-	Game game(&win);
+	Game game(&win, threads);
+	game.SetFrameTimeTarget(frameMs);
+	game.SetWallMode(walls);
+	game.SetPalettized(palettized);
+	game.SetFixedPoint(fixedPoint);
+	game.SetFogDistance(fog);
 
 	sf::Clock frameclock;
 	while (win.isOpen()) {